@@ -31,4 +31,5 @@ rm Make/options
 
 wclean dragModels
 wclean 
+wclean couplingBenchmark
 
@@ -80,4 +80,5 @@ wmake libso dragModels
 wmake libso chPressureGrad
 wmake libso lammpsFoamTurbulenceModels
 wmake 
+wmake couplingBenchmark
 
@@ -0,0 +1,2 @@
+rm run-* -rf
+rm benchmark.csv -f
@@ -0,0 +1,64 @@
+#!/bin/bash
+cd ${0%/*} || exit 1 # Run from this directory
+
+# Strong and weak scaling sweeps of the coupling with lammpsFoamBenchmark.
+# Every run is a copy of a lammpsFoam case with random particles added
+# in LAMMPS; the rows of all the runs are appended to benchmark.csv.
+#
+# Settings (environment variables):
+#   BASE_CASE      lammpsFoam case to copy (../../example-cases/BL24-TH1)
+#   PROCS          processor counts ("1 2 4 8")
+#   STRONG_N       particles added in the strong scaling runs (40000)
+#   WEAK_N         particles added per processor in the weak scaling (10000)
+#   REPEATS        calls per stage (20)
+#   DIAMETER, DENSITY  of the added particles (0.0005, 2500)
+
+currentDIR=$PWD
+baseCase=${BASE_CASE:-../../example-cases/BL24-TH1}
+procs=${PROCS:-"1 2 4 8"}
+strongN=${STRONG_N:-40000}
+weakN=${WEAK_N:-10000}
+repeats=${REPEATS:-20}
+diameter=${DIAMETER:-0.0005}
+density=${DENSITY:-2500}
+csv=$currentDIR/benchmark.csv
+
+# runCase <label> <processors> <particles to add>
+runCase()
+{
+    runDIR=$currentDIR/run-$1-np$2
+    rm -rf $runDIR
+    mkdir -p $runDIR
+    cp -rf $baseCase/0 $baseCase/constant $baseCase/system $runDIR
+    cp -f $baseCase/*.in $runDIR 2>/dev/null
+
+    # Random particles in the whole LAMMPS box after the initial ones
+    sed "/^read_data/a create_atoms 1 random $3 4928 NULL\nset type 1 diameter $diameter density $density" \
+        $baseCase/in.lammps > $runDIR/in.lammps
+
+    sed -i "s/^numberOfSubdomains.*/numberOfSubdomains $2;/; s/^method .*/method          scotch;/" \
+        $runDIR/system/decomposeParDict
+
+    cd $runDIR
+    blockMesh > log.blockMesh
+
+    if [ $2 -gt 1 ]
+    then
+        decomposePar > log.decomposePar
+        mpirun -np $2 lammpsFoamBenchmark -parallel -repeat $repeats \
+            -csv $csv -label $1 > log.benchmark
+    else
+        lammpsFoamBenchmark -repeat $repeats -csv $csv -label $1 \
+            > log.benchmark
+    fi
+
+    cd $currentDIR
+}
+
+for np in $procs
+do
+    runCase strong $np $strongN
+    runCase weak $np $((weakN*np))
+done
+
+echo "Results in $csv"
@@ -15,6 +15,7 @@
 #include "string.h"
 #include "stdlib.h"
 #include "compute_cohe_local.h"
+#include "contact_stats.h"
 #include "fix_cohesive.h"
 #include "atom.h"
 #include "update.h"
@@ -25,6 +26,7 @@
 #include "neigh_list.h"
 #include "group.h"
 #include "memory.h"
+#include "comm.h"
 #include "modify.h"
 #include "error.h"
 
@@ -41,7 +43,21 @@ ComputeCoheLocal::ComputeCoheLocal(LAMMPS *lmp, int narg, char **arg) :
 {
   if (narg < 4) error->all(FLERR,"Illegal compute pair/local command");
 
-  local_flag = 1;
+  statsflag = 0;
+  stats = NULL;
+
+  // compute ID group cohe/local stats: per-atom statistics instead of
+  // the per-pair rows, can be binned by fix ave/spatial
+
+  if (narg == 4 && strcmp(arg[3],"stats") == 0) {
+    statsflag = 1;
+    peratom_flag = 1;
+    size_peratom_cols = 9;
+    comm_reverse = 9;
+    stats = new ContactStats(lmp);
+  }
+
+  local_flag = !statsflag;
   nvalues = narg - 3;
   if (nvalues == 1) size_local_cols = 0;
   else size_local_cols = nvalues;
@@ -50,7 +66,7 @@ ComputeCoheLocal::ComputeCoheLocal(LAMMPS *lmp, int narg, char **arg) :
   pindex = new int[nvalues];
 
   nvalues = 0;
-  for (int iarg = 3; iarg < narg; iarg++) {
+  for (int iarg = 3 + statsflag; iarg < narg; iarg++) {
     if (strcmp(arg[iarg],"dist") == 0) pstyle[nvalues++] = DIST;
     else if (strcmp(arg[iarg],"eng") == 0) pstyle[nvalues++] = ENG;
     else if (strcmp(arg[iarg],"force") == 0) pstyle[nvalues++] = FORCE;
@@ -68,8 +84,8 @@ ComputeCoheLocal::ComputeCoheLocal(LAMMPS *lmp, int narg, char **arg) :
     } else error->all(FLERR,"Invalid keyword in compute pair/local command");
   }
 
-  // the pointer to the fix_fluid_drag class
-  class FixCohe *cohe_ptr = NULL;
+  // the pointer to the fix_cohesive class
+  cohe_ptr = NULL;
 
   int i;
   for (i = 0; i < (modify->nfix); i++)
@@ -78,6 +94,7 @@ ComputeCoheLocal::ComputeCoheLocal(LAMMPS *lmp, int narg, char **arg) :
   if (i < modify->nfix)
     //initialize the pointer
     cohe_ptr = (FixCohe *) modify->fix[i];
+  else error->all(FLERR,"Compute cohe/local requires fix cohesive");
 
   ah = cohe_ptr->ah;
   lam = cohe_ptr->lam;
@@ -101,6 +118,7 @@ ComputeCoheLocal::~ComputeCoheLocal()
 {
   memory->destroy(vector);
   memory->destroy(array);
+  delete stats;
   delete [] pstyle;
   delete [] pindex;
 }
@@ -158,7 +176,7 @@ void ComputeCoheLocal::compute_local()
 int ComputeCoheLocal::compute_pairs(int flag)
 {
   int i,j,m,n,ii,jj,inum,jnum,itype,jtype;
-  double xtmp,ytmp,ztmp,del,delx,dely,delz;
+  double xtmp,ytmp,ztmp,delx,dely,delz;
   double r,rinv,radi,radj,radsum;
   double ccel,ccelx,ccely,ccelz;
   double rsq,eng,fpair,factor_coul,factor_lj;
@@ -227,13 +245,9 @@ int ComputeCoheLocal::compute_pairs(int flag)
 
       if (rsq < (radsum + smax)*(radsum + smax)){
         r = sqrt(rsq);
-        del = r - radsum;
-        if (del > smin)
-          ccel = - ah*pow(radsum,6)/6.0/del/del/(r + radsum)/(r + radsum)
-        /r/r/r;
-        else 
-          ccel = - ah*pow(radsum,6)/6.0/smin/smin/(smin+ 2.0*radsum)/(smin + 2.0*radsum)
-        /(smin + radsum)/(smin + radsum)/(smin + radsum);
+
+        // same force model as the fix
+        ccel = cohe_ptr->pair_force(r,radsum);
         rinv = 1.0/r;
 
         ccelx = delx*ccel*rinv;
@@ -293,6 +307,98 @@ int ComputeCoheLocal::compute_pairs(int flag)
   return m;
 }
 
+/* ----------------------------------------------------------------------
+   per-atom contact statistics, one pass over the neighbor list
+------------------------------------------------------------------------- */
+
+void ComputeCoheLocal::compute_peratom()
+{
+  int i,j,ii,jj,inum,jnum;
+  double xtmp,ytmp,ztmp,delx,dely,delz;
+  double rsq,r,rinv,radi,radsum,fn;
+  int *ilist,*jlist,*numneigh,**firstneigh;
+
+  invoked_peratom = update->ntimestep;
+
+  // grow and zero the statistics of the owned and ghost atoms
+
+  stats->reset();
+  array_atom = stats->stats;
+
+  double **x = atom->x;
+  double *radius = atom->radius;
+  int *mask = atom->mask;
+  int nlocal = atom->nlocal;
+  int newton_pair = force->newton_pair;
+
+  // invoke half neighbor list (will copy or build if necessary)
+
+  neighbor->build_one(list->index);
+
+  inum = list->inum;
+  ilist = list->ilist;
+  numneigh = list->numneigh;
+  firstneigh = list->firstneigh;
+
+
+  // every pair in contact is tallied to its owned atoms
+  // (to the ghost atom too if newton_pair, summed by reverse comm)
+
+  for (ii = 0; ii < inum; ii++) {
+    i = ilist[ii];
+    if (!(mask[i] & groupbit)) continue;
+
+    xtmp = x[i][0];
+    ytmp = x[i][1];
+    ztmp = x[i][2];
+    radi = radius[i];
+    jlist = firstneigh[i];
+    jnum = numneigh[i];
+
+    for (jj = 0; jj < jnum; jj++) {
+      j = jlist[jj];
+      j &= NEIGHMASK;
+
+      if (!(mask[j] & groupbit)) continue;
+
+      delx = xtmp - x[j][0];
+      dely = ytmp - x[j][1];
+      delz = ztmp - x[j][2];
+      rsq = delx*delx + dely*dely + delz*delz;
+      radsum = radi + radius[j];
+      if (rsq >= (radsum + smax)*(radsum + smax)) continue;
+
+      r = sqrt(rsq);
+      rinv = 1.0/r;
+      fn = cohe_ptr->pair_force(r,radsum);
+
+      stats->tally(i,fn,delx*rinv,dely*rinv,delz*rinv);
+      if (newton_pair || j < nlocal)
+        stats->tally(j,fn,delx*rinv,dely*rinv,delz*rinv);
+    }
+  }
+
+  if (newton_pair) comm->reverse_comm_compute(this);
+
+  // means over the contacts
+
+  stats->average();
+}
+
+/* ---------------------------------------------------------------------- */
+
+int ComputeCoheLocal::pack_reverse_comm(int n, int first, double *buf)
+{
+  return stats->pack_reverse_comm(n,first,buf);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void ComputeCoheLocal::unpack_reverse_comm(int n, int *list, double *buf)
+{
+  stats->unpack_reverse_comm(n,list,buf);
+}
+
 /* ---------------------------------------------------------------------- */
 
 void ComputeCoheLocal::reallocate(int n)
@@ -319,5 +425,6 @@ void ComputeCoheLocal::reallocate(int n)
 double ComputeCoheLocal::memory_usage()
 {
   double bytes = nmax*nvalues * sizeof(double);
+  if (stats) bytes += stats->memory_usage();
   return bytes;
 }
@@ -31,6 +31,9 @@ class ComputeCoheLocal : public Compute {
   void init();
   void init_list(int, class NeighList *);
   void compute_local();
+  void compute_peratom();
+  int pack_reverse_comm(int, int, double *);
+  void unpack_reverse_comm(int, int *, double *);
   double memory_usage();
 
  private:
@@ -38,6 +41,7 @@ class ComputeCoheLocal : public Compute {
   double lam; // London retardation wavelength
   double smin; //minimum separation
   double smax; //maximum separation
+  class FixCohe *cohe_ptr; // fix cohesive of the force model
   int nvalues,dflag,eflag,fflag;
   int ncount;
 
@@ -51,6 +55,11 @@ class ComputeCoheLocal : public Compute {
 
   class NeighList *list;
 
+  // stats mode: per-atom contact statistics in one pass, fixed memory
+
+  int statsflag;
+  class ContactStats *stats;
+
   int compute_pairs(int);
   void reallocate(int);
 };
@@ -72,6 +81,11 @@ E: Invalid keyword in compute cohe/local command
 
 Self-explanatory.
 
+E: Compute cohe/local requires fix cohesive
+
+The cohesive force model is taken from fix cohesive, which has to be
+defined before the compute.
+
 E: No gran style is defined for compute cohe/local
 
 Self-explanatory.
@@ -15,6 +15,7 @@
 #include "string.h"
 #include "stdlib.h"
 #include "compute_gran_local.h"
+#include "contact_stats.h"
 #include "atom.h"
 #include "update.h"
 #include "force.h"
@@ -24,6 +25,7 @@
 #include "neigh_list.h"
 #include "group.h"
 #include "memory.h"
+#include "comm.h"
 #include "error.h"
 
 using namespace LAMMPS_NS;
@@ -39,7 +41,21 @@ ComputeGranLocal::ComputeGranLocal(LAMMPS *lmp, int narg, char **arg) :
 {
   if (narg < 4) error->all(FLERR,"Illegal compute pair/local command");
 
-  local_flag = 1;
+  statsflag = 0;
+  stats = NULL;
+
+  // compute ID group gran/local stats: per-atom statistics instead of
+  // the per-pair rows, can be binned by fix ave/spatial
+
+  if (narg == 4 && strcmp(arg[3],"stats") == 0) {
+    statsflag = 1;
+    peratom_flag = 1;
+    size_peratom_cols = 9;
+    comm_reverse = 9;
+    stats = new ContactStats(lmp);
+  }
+
+  local_flag = !statsflag;
   nvalues = narg - 3;
   if (nvalues == 1) size_local_cols = 0;
   else size_local_cols = nvalues;
@@ -48,7 +64,7 @@ ComputeGranLocal::ComputeGranLocal(LAMMPS *lmp, int narg, char **arg) :
   pindex = new int[nvalues];
 
   nvalues = 0;
-  for (int iarg = 3; iarg < narg; iarg++) {
+  for (int iarg = 3 + statsflag; iarg < narg; iarg++) {
     if (strcmp(arg[iarg],"dist") == 0) pstyle[nvalues++] = DIST;
     else if (strcmp(arg[iarg],"eng") == 0) pstyle[nvalues++] = ENG;
     else if (strcmp(arg[iarg],"force") == 0) pstyle[nvalues++] = FORCE;
@@ -71,6 +87,7 @@ ComputeGranLocal::ComputeGranLocal(LAMMPS *lmp, int narg, char **arg) :
   singleflag = 0;
   for (int i = 0; i < nvalues; i++)
     if (pstyle[i] != DIST) singleflag = 1;
+  if (statsflag) singleflag = 1;
 
   nmax = 0;
   vector = NULL;
@@ -83,6 +100,7 @@ ComputeGranLocal::~ComputeGranLocal()
 {
   memory->destroy(vector);
   memory->destroy(array);
+  delete stats;
   delete [] pstyle;
   delete [] pindex;
 }
@@ -247,6 +265,107 @@ int ComputeGranLocal::compute_pairs(int flag)
   return m;
 }
 
+/* ----------------------------------------------------------------------
+   per-atom contact statistics, one pass over the neighbor list
+------------------------------------------------------------------------- */
+
+void ComputeGranLocal::compute_peratom()
+{
+  int i,j,ii,jj,inum,jnum,itype,jtype;
+  double xtmp,ytmp,ztmp,delx,dely,delz;
+  double rsq,r,rinv,radi,radsum,fn,fpair,factor_coul,factor_lj;
+  int *ilist,*jlist,*numneigh,**firstneigh;
+
+  invoked_peratom = update->ntimestep;
+
+  // grow and zero the statistics of the owned and ghost atoms
+
+  stats->reset();
+  array_atom = stats->stats;
+
+  double **x = atom->x;
+  double *radius = atom->radius;
+  int *type = atom->type;
+  int *mask = atom->mask;
+  int nlocal = atom->nlocal;
+  double *special_coul = force->special_coul;
+  double *special_lj = force->special_lj;
+  int newton_pair = force->newton_pair;
+
+  // invoke half neighbor list (will copy or build if necessary)
+
+  neighbor->build_one(list->index);
+
+  inum = list->inum;
+  ilist = list->ilist;
+  numneigh = list->numneigh;
+  firstneigh = list->firstneigh;
+
+  Pair *pair = force->pair;
+
+  // every pair in contact is tallied to its owned atoms
+  // (to the ghost atom too if newton_pair, summed by reverse comm)
+
+  for (ii = 0; ii < inum; ii++) {
+    i = ilist[ii];
+    if (!(mask[i] & groupbit)) continue;
+
+    xtmp = x[i][0];
+    ytmp = x[i][1];
+    ztmp = x[i][2];
+    itype = type[i];
+    radi = radius[i];
+    jlist = firstneigh[i];
+    jnum = numneigh[i];
+
+    for (jj = 0; jj < jnum; jj++) {
+      j = jlist[jj];
+      factor_lj = special_lj[sbmask(j)];
+      factor_coul = special_coul[sbmask(j)];
+      j &= NEIGHMASK;
+
+      if (!(mask[j] & groupbit)) continue;
+
+      delx = xtmp - x[j][0];
+      dely = ytmp - x[j][1];
+      delz = ztmp - x[j][2];
+      rsq = delx*delx + dely*dely + delz*delz;
+      jtype = type[j];
+      radsum = radi + radius[j];
+      if (rsq >= radsum*radsum) continue;
+
+      r = sqrt(rsq);
+      rinv = 1.0/r;
+      pair->single(i,j,itype,jtype,rsq,factor_coul,factor_lj,fpair);
+      fn = r*fpair;
+
+      stats->tally(i,fn,delx*rinv,dely*rinv,delz*rinv);
+      if (newton_pair || j < nlocal)
+        stats->tally(j,fn,delx*rinv,dely*rinv,delz*rinv);
+    }
+  }
+
+  if (newton_pair) comm->reverse_comm_compute(this);
+
+  // means over the contacts
+
+  stats->average();
+}
+
+/* ---------------------------------------------------------------------- */
+
+int ComputeGranLocal::pack_reverse_comm(int n, int first, double *buf)
+{
+  return stats->pack_reverse_comm(n,first,buf);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void ComputeGranLocal::unpack_reverse_comm(int n, int *list, double *buf)
+{
+  stats->unpack_reverse_comm(n,list,buf);
+}
+
 /* ---------------------------------------------------------------------- */
 
 void ComputeGranLocal::reallocate(int n)
@@ -273,5 +392,6 @@ void ComputeGranLocal::reallocate(int n)
 double ComputeGranLocal::memory_usage()
 {
   double bytes = nmax*nvalues * sizeof(double);
+  if (stats) bytes += stats->memory_usage();
   return bytes;
 }
@@ -31,6 +31,9 @@ class ComputeGranLocal : public Compute {
   void init();
   void init_list(int, class NeighList *);
   void compute_local();
+  void compute_peratom();
+  int pack_reverse_comm(int, int, double *);
+  void unpack_reverse_comm(int, int *, double *);
   double memory_usage();
 
  private:
@@ -47,6 +50,11 @@ class ComputeGranLocal : public Compute {
 
   class NeighList *list;
 
+  // stats mode: per-atom contact statistics in one pass, fixed memory
+
+  int statsflag;
+  class ContactStats *stats;
+
   int compute_pairs(int);
   void reallocate(int);
 };
@@ -0,0 +1,127 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include "math.h"
+#include "contact_stats.h"
+#include "atom.h"
+#include "memory.h"
+
+using namespace LAMMPS_NS;
+
+#define NCOLS 9
+
+/* ---------------------------------------------------------------------- */
+
+ContactStats::ContactStats(LAMMPS *lmp) : Pointers(lmp)
+{
+  nmaxatom = 0;
+  stats = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+ContactStats::~ContactStats()
+{
+  memory->destroy(stats);
+}
+
+/* ----------------------------------------------------------------------
+   grow the per-atom array with the atoms (ghosts for newton on)
+   and zero it for a new tally
+------------------------------------------------------------------------- */
+
+void ContactStats::reset()
+{
+  if (atom->nmax > nmaxatom) {
+    memory->destroy(stats);
+    nmaxatom = atom->nmax;
+    memory->create(stats,nmaxatom,NCOLS,"contact/stats:stats");
+  }
+
+  int nall = atom->nlocal + atom->nghost;
+  for (int i = 0; i < nall; i++)
+    for (int k = 0; k < NCOLS; k++) stats[i][k] = 0.0;
+}
+
+/* ----------------------------------------------------------------------
+   one contact of atom i: normal force fn, unit normal nx ny nz
+------------------------------------------------------------------------- */
+
+void ContactStats::tally(int i, double fn, double nx, double ny, double nz)
+{
+  double *s = stats[i];
+  s[0] += 1.0;
+  s[1] += fabs(fn);
+  if (fabs(fn) > s[2]) s[2] = fabs(fn);
+  s[3] += nx*nx;
+  s[4] += ny*ny;
+  s[5] += nz*nz;
+  s[6] += nx*ny;
+  s[7] += nx*nz;
+  s[8] += ny*nz;
+}
+
+/* ----------------------------------------------------------------------
+   means over the contacts of the owned atoms, after the reverse comm
+------------------------------------------------------------------------- */
+
+void ContactStats::average()
+{
+  int nlocal = atom->nlocal;
+
+  for (int i = 0; i < nlocal; i++) {
+    if (stats[i][0] > 0.0) {
+      double cinv = 1.0/stats[i][0];
+      stats[i][1] *= cinv;
+      for (int k = 3; k < NCOLS; k++) stats[i][k] *= cinv;
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+int ContactStats::pack_reverse_comm(int n, int first, double *buf)
+{
+  int i,k,m,last;
+
+  m = 0;
+  last = first + n;
+  for (i = first; i < last; i++)
+    for (k = 0; k < NCOLS; k++) buf[m++] = stats[i][k];
+  return NCOLS;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void ContactStats::unpack_reverse_comm(int n, int *list, double *buf)
+{
+  int i,j,k,m;
+
+  m = 0;
+  for (i = 0; i < n; i++) {
+    j = list[i];
+    for (k = 0; k < NCOLS; k++) {
+      if (k == 2) {
+        if (buf[m] > stats[j][k]) stats[j][k] = buf[m];
+      } else stats[j][k] += buf[m];
+      m++;
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+double ContactStats::memory_usage()
+{
+  return nmaxatom*NCOLS * sizeof(double);
+}
@@ -0,0 +1,44 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifndef LMP_CONTACT_STATS_H
+#define LMP_CONTACT_STATS_H
+
+#include "pointers.h"
+
+namespace LAMMPS_NS {
+
+// per-atom contact statistics of compute gran/local and cohe/local stats
+// columns: contacts, mean and max |normal force|, fabric tensor
+// (mean of n n over the contacts: xx yy zz xy xz yz)
+
+class ContactStats : protected Pointers {
+ public:
+  double **stats;
+
+  ContactStats(class LAMMPS *);
+  ~ContactStats();
+  void reset();
+  void tally(int, double, double, double, double);
+  void average();
+  int pack_reverse_comm(int, int, double *);
+  void unpack_reverse_comm(int, int *, double *);
+  double memory_usage();
+
+ private:
+  int nmaxatom;
+};
+
+}
+
+#endif
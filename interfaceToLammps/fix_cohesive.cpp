@@ -27,6 +27,11 @@
 #include "mpi.h"
 #include "comm.h"
 #include "memory.h"
+#include "pair.h"
+
+#if defined(_OPENMP)
+#include "omp.h"
+#endif
 
 
 using namespace LAMMPS_NS;
@@ -46,7 +51,16 @@ FixCohe::FixCohe(LAMMPS *lmp, int narg, char **arg) :
   smax = atof(arg[6]);
   opt = atoi(arg[7]);
 
-  printf("ah lam smin opt %g %g %g %i \n", ah, lam, smin,opt);
+  if (opt != 0 && opt != 1)
+    error->all(FLERR,"invalid option for cohesive force model");
+
+  if (comm->me == 0) {
+    if (screen) fprintf(screen,"ah lam smin opt %g %g %g %i \n",
+                        ah,lam,smin,opt);
+    if (logfile) fprintf(logfile,"ah lam smin opt %g %g %g %i \n",
+                         ah,lam,smin,opt);
+  }
+
   nmax = 0;
   nvalues = 7;   // Number of output columns : PID FX FY FZ NX NY NZ
   laststep = -1;
@@ -54,6 +68,21 @@ FixCohe::FixCohe(LAMMPS *lmp, int narg, char **arg) :
   local_flag = 1;
   laststep_local = -1; // last time step for compute_local()
   // compute_local_flag = 1; // Calling compute_local flag
+
+  array_local = NULL;
+  list = NULL;
+  sharelist = 0;
+  nthreads = 0;
+  maxall = 0;
+  thr_f = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+FixCohe::~FixCohe()
+{
+  memory->destroy(array_local);
+  memory->destroy(thr_f);
 }
 
 /* ---------------------------------------------------------------------- */
@@ -70,16 +99,37 @@ int FixCohe::setmask()
 /* ---------------------------------------------------------------------- */
 
 void FixCohe::init()
-{ 
+{
+  // constants of the force models
 
- int irequest = neighbor->request((void *) this);
-  neighbor->requests[irequest]->pair = 0;
-  neighbor->requests[irequest]->fix = 1;
-  
+  double PInv = 0.25/atan(1.0);
 
-if (strcmp(update->integrate_style,"respa") == 0)
-    nlevels_respa = ((Respa *) update->integrate)->nlevels;
+  lamcut = lam*PInv;
+  cfar = - ah*lam;
+  cfar1 = 4.5316e-4*lam;
+  cfar2 = 1.1326e-5*lam*lam;
+  cmid = - ah*lam/24.0;
+  csat = - ah*(lam + 22.242*smin)*lam/24.0/(lam + 11.121*smin)
+    /(lam + 11.121*smin)/smin/smin;
+  cvdw = - ah/6.0;
+
+  // the size list of the granular pair style only guarantees the pairs
+  // within radsum between two rebuilds: it is shared only if the
+  // cohesion acts in contact (smax <= 0), else pairs closing into
+  // (0,smax] after a rebuild would be missed and we keep our own list
+
+  sharelist = 0;
+  if (force->pair && force->pair_match("gran",0) && smax <= 0.0)
+    sharelist = 1;
+
+  if (!sharelist) {
+    int irequest = neighbor->request((void *) this);
+    neighbor->requests[irequest]->pair = 0;
+    neighbor->requests[irequest]->fix = 1;
+  }
 
+  if (strcmp(update->integrate_style,"respa") == 0)
+    nlevels_respa = ((Respa *) update->integrate)->nlevels;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -91,12 +141,20 @@ void FixCohe::init_list(int id, NeighList *ptr)
 
 /* ---------------------------------------------------------------------- */
 
+NeighList *FixCohe::neighbor_list()
+{
+  if (sharelist) return force->pair->list;
+  return list;
+}
+
+/* ---------------------------------------------------------------------- */
+
 void FixCohe::compute_local()
 {
      if(laststep_local == update->ntimestep)
        return;
         
-      int npairs = count_pairs(0);
+      int npairs = count_pairs();
       
      //nmax = nconts
      if (npairs > nmax)     
@@ -137,129 +195,127 @@ void FixCohe::min_setup()
 
 void FixCohe::post_force(int vflag)
 {
-  int i,ii=0,j=0,jj=0,k,*numneigh,inum,**firstneigh;
-  int jnum;
+  NeighList *nlist = neighbor_list();
+  int inum = nlist->inum;
+  int nall = atom->nlocal + atom->nghost;
+
+  int nthr = 1;
+#if defined(_OPENMP)
+  nthr = omp_get_max_threads();
+#endif
+
+  // thread 0 adds to f, the others to their own arrays (half list)
+
+  if (nthr != nthreads || nall > maxall) {
+    memory->destroy(thr_f);
+    thr_f = NULL;
+    nthreads = nthr;
+    if (nall > maxall) maxall = nall;
+    if (nthreads > 1)
+      memory->create(thr_f,nthreads-1,maxall,3,"cohe:thr_f");
+  }
+
+#if defined(_OPENMP)
+#pragma omp parallel default(shared) num_threads(nthr)
+#endif
+  {
+    int tid = 0;
+#if defined(_OPENMP)
+    tid = omp_get_thread_num();
+#endif
+
+    double **f = atom->f;
+    if (tid > 0) {
+      f = thr_f[tid-1];
+      memset(&f[0][0],0,3*nall*sizeof(double));
+    }
+
+    int chunk = (inum + nthr - 1) / nthr;
+    int ifrom = tid*chunk;
+    int ito = ifrom + chunk;
+    if (ifrom > inum) ifrom = inum;
+    if (ito > inum) ito = inum;
+
+    eval(ifrom,ito,f);
+
+    if (nthr > 1) {
+#if defined(_OPENMP)
+#pragma omp barrier
+#pragma omp for schedule(static)
+#endif
+      for (int i = 0; i < nall; i++)
+        for (int t = 0; t < nthr-1; t++) {
+          atom->f[i][0] += thr_f[t][i][0];
+          atom->f[i][1] += thr_f[t][i][1];
+          atom->f[i][2] += thr_f[t][i][2];
+        }
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------
+   cohesive forces of atoms ilist[ifrom] to ilist[ito-1] added to f
+------------------------------------------------------------------------- */
+
+void FixCohe::eval(int ifrom, int ito, double **f)
+{
+  int i,j,ii,jj,jnum;
   double xtmp,ytmp,ztmp,delx,dely,delz;
-  double radi,radj,radsum,rsq,r, rinv;
+  double radi,radsum,rsq,r,rcut;
   double ccel,ccelx,ccely,ccelz;
-  int *jlist,*ilist;
-  double del;
-  double **f = atom->f;
+  int *jlist;
+
   double **x = atom->x;
   double *radius = atom->radius;
   int nlocal = atom->nlocal;
   int newton_pair = force->newton_pair;
   int *mask = atom->mask;
 
-  double PInv = 0.25/atan(1.0);
-  inum = list->inum;
-  ilist = list->ilist;
-  numneigh = list->numneigh;
-  firstneigh = list->firstneigh;
-  
+  NeighList *nlist = neighbor_list();
+  int *ilist = nlist->ilist;
+  int *numneigh = nlist->numneigh;
+  int **firstneigh = nlist->firstneigh;
+
   // loop over neighbors of my atoms
 
-  if (opt == 0){
-   printf(" inum %i", inum);
-  
-  for (ii = 0; ii < nlocal; ii++){
-	  i = ilist[ii];
-	  if (!(mask[i] & groupbit)) continue;
-	  xtmp = x[i][0];
-	  ytmp = x[i][1];
-	  ztmp = x[i][2];
-	  radi = radius[i];
-	  jlist = firstneigh[i];
-	  jnum = numneigh[i];
-
-	  for (jj = 0; jj < jnum; jj++) {
-		  j = jlist[jj];
-		  delx = xtmp - x[j][0];
-		  dely = ytmp - x[j][1];
-		  delz = ztmp - x[j][2];
-		  rsq = delx*delx + dely*dely + delz*delz;
-		  radj = radius[j];
-		  radsum = radi + radj;
-
-	  if (rsq < (radsum + smax)*(radsum + smax)) {
-	    r = sqrt(rsq);
-	    del = r - radsum;
-	    if (del > lam*PInv)
-	      ccel = - ah*radsum*lam*
-		(6.4988e-3 - 4.5316e-4*lam/del + 1.1326e-5*lam*lam/del/del)/del/del/del;
-	    else if (del > smin)
-	      ccel = - ah * (lam + 22.242*del)*radsum*lam/24.0/(lam + 11.121*del)
-		/(lam + 11.121*del)/del/del;
-	    else 
-	      ccel = - ah * (lam + 22.242*smin)*radsum*lam/24.0/(lam + 11.121*smin)
-	    /(lam + 11.121*smin)/smin/smin;
-	    rinv = 1/r;
-
-	    ccelx = delx*ccel*rinv ;
-	    ccely = dely*ccel*rinv ;
-	    ccelz = delz*ccel*rinv ;
-	    f[i][0] += ccelx;
-	    f[i][1] += ccely;
-	    f[i][2] += ccelz;
-
-	    if (newton_pair || j < nlocal) {
-	      f[j][0] -= ccelx;
-	      f[j][1] -= ccely;
-	      f[j][2] -= ccelz;
-	    }
-	  }
-	}
-  }
-}else if (opt ==1){      
-
-
-   for (ii = 0; ii < nlocal; ii++){
-	i = ilist[ii];
-	if (!(mask[i] & groupbit)) continue;
-	xtmp = x[i][0];
-	ytmp = x[i][1];
-	ztmp = x[i][2];
-	radi = radius[i];
-	jlist = firstneigh[i];
-	jnum = numneigh[i];
-                  
-
-	for (jj = 0; jj < jnum; jj++) {
-	  j = jlist[jj];
-	  delx = xtmp - x[j][0];
-	  dely = ytmp - x[j][1];
-	  delz = ztmp - x[j][2];
-	  rsq = delx*delx + dely*dely + delz*delz;
-	  radj = radius[j];
-	  radsum = radi + radj;
-	  
-	  if (rsq < (radsum + smax)*(radsum + smax)){
-	    r = sqrt(rsq);
-	    del = r - radsum;
-	    if (del > smin)
-	      ccel = - ah*pow(radsum,6)/6.0/del/del/(r + radsum)/(r + radsum)
-		/r/r/r;
-	    else 
-	      ccel = - ah*pow(radsum,6)/6.0/smin/smin/(smin+ 2.0*radsum)/(smin + 2.0*radsum)
-		/(smin + radsum)/(smin + radsum)/(smin + radsum);
-	    rinv = 1/r;
-
-	    ccelx = delx*ccel*rinv;
-	    ccely = dely*ccel*rinv;
-	    ccelz = delz*ccel*rinv;
-	    f[i][0] += ccelx;
-	    f[i][1] += ccely;
-	    f[i][2] += ccelz;
-
-		if (newton_pair || j < nlocal){
-	      f[j][0] -= ccelx;
-	      f[j][1] -= ccely;
-	      f[j][2] -= ccelz;
-	    }
-	  }
-	}
+  for (ii = ifrom; ii < ito; ii++) {
+    i = ilist[ii];
+    if (!(mask[i] & groupbit)) continue;
+    xtmp = x[i][0];
+    ytmp = x[i][1];
+    ztmp = x[i][2];
+    radi = radius[i];
+    jlist = firstneigh[i];
+    jnum = numneigh[i];
+
+    for (jj = 0; jj < jnum; jj++) {
+      j = jlist[jj] & NEIGHMASK;
+      delx = xtmp - x[j][0];
+      dely = ytmp - x[j][1];
+      delz = ztmp - x[j][2];
+      rsq = delx*delx + dely*dely + delz*delz;
+      radsum = radi + radius[j];
+      rcut = radsum + smax;
+
+      if (rsq < rcut*rcut) {
+        r = sqrt(rsq);
+        ccel = pair_force(r,radsum)/r;
+
+        ccelx = delx*ccel;
+        ccely = dely*ccel;
+        ccelz = delz*ccel;
+        f[i][0] += ccelx;
+        f[i][1] += ccely;
+        f[i][2] += ccelz;
+
+        if (newton_pair || j < nlocal) {
+          f[j][0] -= ccelx;
+          f[j][1] -= ccely;
+          f[j][2] -= ccelz;
+        }
+      }
+    }
   }
-}else error->all(FLERR,"invalid option for cohesive force model");
 }
 
 
@@ -291,37 +347,31 @@ void FixCohe::extract_cohe(int *p_opt, double *p_ah, double *p_lam,
 
 /* Count the number of pairs of the contact first. */
 
-int FixCohe::count_pairs(int flag)
+int FixCohe::count_pairs()
 { 
-
-  
-  int i,j,m,ii,jj,inum,jnum,itype;
+  int i,j,m,ii,jj,inum,jnum;
   double xtmp,ytmp,ztmp,delx,dely,delz,radi,radsum;
   int *ilist,*jlist,*numneigh,**firstneigh;
-  double rsq,factor_lj,factor_coul;
+  double rsq;
 
   double **x = atom->x;
   double *radius = atom->radius;
-  int *type = atom->type;
   int *mask = atom->mask;
   int nlocal = atom->nlocal;
   int newton_pair = force->newton_pair;
 
+  // the list is rebuilt with the atoms at every reneighboring, as
+  // used by post_force: no build on demand
 
- // double *special_coul = force->special_coul;
- // double *special_lj = force->special_lj;
-// Invoke half neighbor list (will copy or build if necessary)  
-  if (flag == 0) neighbor->build_one(list->index);
-
-  inum = list->inum;
-  ilist = list->ilist;
-  numneigh = list->numneigh;
-  firstneigh = list->firstneigh;
+  NeighList *nlist = neighbor_list();
+  inum = nlist->inum;
+  ilist = nlist->ilist;
+  numneigh = nlist->numneigh;
+  firstneigh = nlist->firstneigh;
 
   // Loop over neighbours of my atoms 
   // Skip if I or J are not in group 
-  // for flag = 0 just count the pair interactions within force cutoff 
-  // for flag = 1, calculate requested output fields. 
+  // just count the pair interactions within force cutoff 
   m = 0;
   for (ii = 0; ii<inum; ii++)
      {i = ilist[ii];
@@ -331,14 +381,11 @@ int FixCohe::count_pairs(int flag)
      ytmp = x[i][1];
      ztmp = x[i][2];
      radi = radius[i];
-     itype = type[i];
      jlist = firstneigh[i];
      jnum = numneigh[i];
 
    for (jj = 0; jj < jnum; jj++) {
       j = jlist[jj];
-     // factor_lj = special_lj[sbmask(j)];
-     // factor_coul = special_coul[sbmask(j)];
       j &= NEIGHMASK;
 
       if (!(mask[j] & groupbit)) continue;
@@ -359,172 +406,80 @@ int FixCohe::count_pairs(int flag)
 
 }
 
+/* One row per particle of each pair counted by count_pairs. */
+
 void FixCohe::calc_pairs()
 {  
-   int i,j=0,m,n,ii=0,jj=0,k,inum,*numneigh,**firstneigh;  
+   int i,j,n,ii,jj,inum,*numneigh,**firstneigh;  
    int jnum;
-   double xtmp,ytmp,ztmp,delx,dely,delz,radi,radj,radsum;
-   double facti,factj;
-   double rsq,rinv,r,del;
+   double xtmp,ytmp,ztmp,delx,dely,delz,radi,radsum;
+   double rsq,r,ccel;
    int *jlist, *ilist;
-   double ccel,ccelx,ccely,ccelz;
-   double **x = atom->x;
-   double **v = atom->v;
    double f[3]; 
+   double **x = atom->x;
    int *tag = atom->tag;
-   double **omega = atom->omega;
-   double torque[3];
    double *radius = atom->radius;
-   double *rmass = atom->rmass;
    int *mask = atom->mask;
    int nlocal = atom->nlocal;
-   
-  double PInv = 0.25/atan(1.0); 
-  inum = list->inum;
-  ilist = list->ilist;
-  numneigh=list->numneigh;
-  firstneigh=list->firstneigh;
+   int newton_pair = force->newton_pair;
+
+  NeighList *nlist = neighbor_list();
+  inum = nlist->inum;
+  ilist = nlist->ilist;
+  numneigh = nlist->numneigh;
+  firstneigh = nlist->firstneigh;
 
   n = 0;
-  nmax = size_local_rows;
-  
-  if (opt == 0)
-  {
-    
-  for ( ii = 0; ii < nlocal; i++)
-     {
-         i = ilist[ii];
-         xtmp = x[i][0];
-         ytmp = x[i][1];
-         ztmp = x[i][2];
-         radi = radius[i];
-         jlist = firstneigh[i];
-         jnum = numneigh[i];
-
-       	  for (jj = 0; jj < jnum; jj++)
-          {
-		  j = jlist[jj];
-		  delx = xtmp - x[j][0];
-		  dely = ytmp - x[j][1];
-		  delz = ztmp - x[j][2];
-		  rsq = delx*delx + dely*dely + delz*delz;
-		  radj = radius[j];
-		  radsum = radi + radj;
-
-	         if (rsq < (radsum + smax)*(radsum + smax)) 
-                  {
-                    f[0] = 0.0 ; f[1] = 0.0 ; f[2] = 0.0;
-	            r = sqrt(rsq);
-	            del = r - radsum;
-	            if (del > lam*PInv)
-	            ccel = - ah*radsum*lam*(6.4988e-3 - 4.5316e-4*lam/del + 1.1326e-5*lam*lam/del/del)/del/del/del;
-	            else if (del > smin)
-	            ccel = - ah * (lam + 22.242*del)*radsum*lam/24.0/(lam + 11.121*del)/(lam + 11.121*del)/del/del;
-	            else 
-	            ccel = - ah * (lam + 22.242*smin)*radsum*lam/24.0/(lam + 11.121*smin)/(lam + 11.121*smin)/smin/smin;
-	    
-                    rinv = 1/r;
-
-	            ccelx = delx*ccel*rinv ;
-	            ccely = dely*ccel*rinv ;
-	            ccelz = delz*ccel*rinv ;
-	            f[0] += ccelx;
-	            f[1] += ccely;
-	            f[2] += ccelz;
-
-               //     facti = (radi + (del*0.5))/2 ;
-               //     factj = (radj + (del*0.5))/2 ;
-                     
-                         array_local[n][0] = tag[i];
-                         array_local[n][1] = f[0];
-                         array_local[n][2] = f[1];
-                         array_local[n][3] = f[2];
-                         array_local[n][4] = delx;
-                         array_local[n][5] = dely;
-                         array_local[n][6] = delz;  
-			n++;
-                         array_local[n][0] = tag[j];
-                         array_local[n][1] = -f[0];
-                         array_local[n][2] = -f[1];
-                         array_local[n][3] = -f[2];
-                         array_local[n][4] = -delx;
-                         array_local[n][5] = -dely;
-                         array_local[n][6] = -delz;  
-                        n++;
-
-	          }
-            }
-        
-     }
- }
-
-
-
-else if (opt ==1){
-
-   for (ii = 0; ii < nlocal; ii++){
-	i = ilist[ii];
-	if (!(mask[i] & groupbit)) continue;
-	xtmp = x[i][0];
-	ytmp = x[i][1];
-	ztmp = x[i][2];
-	radi = radius[i];
-	jlist = firstneigh[i];
-	jnum = numneigh[i];
-
-	for (jj = 0; jj < jnum ; jj++) {
-	  j = jlist[jj];
-	  delx = xtmp - x[j][0];
-	  dely = ytmp - x[j][1];
-	  delz = ztmp - x[j][2];
-	  rsq = delx*delx + dely*dely + delz*delz;
-	  radj = radius[j];
-	  radsum = radi + radj;
-	  
-	  if (rsq < (radsum + smax)*(radsum + smax)){
-	    r = sqrt(rsq);
-	    del = r - radsum;
-            f[0] = 0.0 ; f[1]= 0.0; f[2]= 0.0;
-	    if (del > smin)
-	      ccel = - ah*pow(radsum,6)/6.0/del/del/(r + radsum)/(r + radsum)
-		/r/r/r;
-	    else 
-	      ccel = - ah*pow(radsum,6)/6.0/smin/smin/(smin+ 2.0*radsum)/(smin + 2.0*radsum)
-		/(smin + radsum)/(smin + radsum)/(smin + radsum);
-	    rinv = 1/r;
-
-	    ccelx = delx*ccel*rinv;
-	    ccely = dely*ccel*rinv;
-	    ccelz = delz*ccel*rinv;
-	    f[0] += ccelx;
-	    f[1] += ccely;
-	    f[2] += ccelz;
-            
-                     
-                         array_local[n][0] = tag[i];
-                         array_local[n][1] = f[0];
-                         array_local[n][2] = f[1];
-                         array_local[n][3] = f[2];
-                         array_local[n][4] = delx;
-                         array_local[n][5] = dely;
-                         array_local[n][6] = delz;  
-			n++;
-                         array_local[n][0] = tag[j];
-                         array_local[n][1] = -f[0];
-                         array_local[n][2] = -f[1];
-                         array_local[n][3] = -f[2];
-                         array_local[n][4] = -delx;
-                         array_local[n][5] = -dely;
-                         array_local[n][6] = -delz;  
-                       n++;
-
-	  }
-	}
-  }
-}else error->all(FLERR,"invalid compute option for this fix cohesion");
 
+  for (ii = 0; ii < inum; ii++) {
+    i = ilist[ii];
+    if (!(mask[i] & groupbit)) continue;
+    xtmp = x[i][0];
+    ytmp = x[i][1];
+    ztmp = x[i][2];
+    radi = radius[i];
+    jlist = firstneigh[i];
+    jnum = numneigh[i];
 
+    for (jj = 0; jj < jnum; jj++) {
+      j = jlist[jj] & NEIGHMASK;
 
+      if (!(mask[j] & groupbit)) continue;
+      if (newton_pair == 0 && j >= nlocal) continue;
+
+      delx = xtmp - x[j][0];
+      dely = ytmp - x[j][1];
+      delz = ztmp - x[j][2];
+      rsq = delx*delx + dely*dely + delz*delz;
+      radsum = radi + radius[j];
+
+      if (rsq < (radsum + smax)*(radsum + smax)) {
+        r = sqrt(rsq);
+        ccel = pair_force(r,radsum)/r;
+
+        f[0] = delx*ccel;
+        f[1] = dely*ccel;
+        f[2] = delz*ccel;
+
+        array_local[n][0] = tag[i];
+        array_local[n][1] = f[0];
+        array_local[n][2] = f[1];
+        array_local[n][3] = f[2];
+        array_local[n][4] = delx;
+        array_local[n][5] = dely;
+        array_local[n][6] = delz;
+        n++;
+        array_local[n][0] = tag[j];
+        array_local[n][1] = -f[0];
+        array_local[n][2] = -f[1];
+        array_local[n][3] = -f[2];
+        array_local[n][4] = -delx;
+        array_local[n][5] = -dely;
+        array_local[n][6] = -delz;
+        n++;
+      }
+    }
+  }
 }
 
 
@@ -545,7 +500,3 @@ void FixCohe::reallocate(int n)
   size_local_cols = nvalues;
 
 }
-
-
-
-
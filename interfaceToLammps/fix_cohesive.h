@@ -27,7 +27,7 @@ namespace LAMMPS_NS {
 class FixCohe : public Fix {
  public:
   FixCohe(class LAMMPS *, int, char **);
-//  ~FixCohe();
+  ~FixCohe();
   int setmask();
   void init();
   void init_list(int, class NeighList *);
@@ -46,6 +46,34 @@ class FixCohe : public Fix {
   double lam; // London retardation wavelength
   double smin; //minimum separation
 
+  // cohesive force over distance (ccel) of a pair at distance r with
+  // radius sum radsum, from the constants of init()
+
+  inline double pair_force(double r, double radsum) const {
+    double del = r - radsum;
+    if (opt == 0) {
+      if (del > lamcut) {
+        double dinv = 1.0/del;
+        return cfar*radsum*(6.4988e-3 - cfar1*dinv + cfar2*dinv*dinv)
+          *dinv*dinv*dinv;
+      } else if (del > smin) {
+        double t = lam + 11.121*del;
+        return cmid*(lam + 22.242*del)*radsum/(t*t*del*del);
+      } else return csat*radsum;
+    } else {
+      double rs2 = radsum*radsum;
+      double rs6 = rs2*rs2*rs2;
+      if (del > smin) {
+        double rp = r + radsum;
+        return cvdw*rs6/(del*del*rp*rp*r*r*r);
+      } else {
+        double s2 = smin + 2.0*radsum;
+        double s1 = smin + radsum;
+        return cvdw*rs6/(smin*smin*s2*s2*s1*s1*s1);
+      }
+    }
+  }
+
  private:
   int opt; //option for cohesive force model
   int nlevels_respa;
@@ -54,10 +82,26 @@ class FixCohe : public Fix {
   bigint laststep;
   bigint laststep_local;
 
+  // constants of the force models (init)
+  double lamcut;             // retarded regime beyond this separation
+  double cfar,cfar1,cfar2;   // opt 0, retarded regime
+  double cmid;               // opt 0, smin < del < lamcut
+  double csat;               // opt 0, del <= smin (times radsum)
+  double cvdw;               // opt 1
+
+  // pairs from the neighbor list of the granular pair style
+  int sharelist;
+
+  // per-thread force arrays of threads 1 to nthreads-1
+  int nthreads, maxall;
+  double ***thr_f;
+
   class NeighList *list;
-  int count_pairs(int flag);  // Count number of cohesive interactions for a particle 
+  class NeighList *neighbor_list();
+  int count_pairs();  // Count number of cohesive interactions for a particle 
   void reallocate(int n);
   void calc_pairs();
+  void eval(int, int, double **);
 };
 
 }
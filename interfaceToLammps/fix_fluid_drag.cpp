@@ -22,9 +22,11 @@
 #include "error.h"
 #include "memory.h"
 #include "force.h"
+#include "math_const.h"
 
 using namespace LAMMPS_NS;
 using namespace FixConst;
+using namespace MathConst;
 
 /* ---------------------------------------------------------------------- */
 
@@ -45,12 +47,19 @@ FixFluidDrag::FixFluidDrag(LAMMPS *lmp, int narg, char **arg) :
   grow_arrays(atom->nmax);
   atom->add_callback(0);
   force_reneighbor = 0; // when adding particles, set this value to 1.
+  create_attribute = 1;
+
+  // zero the coupling state once here and for new atoms in set_arrays(),
+  // not in init(): a re-setup (e.g. after a rebalance) must keep the
+  // foamCpuId, vOld and drag of the atoms
+
+  for (int i = 0; i < atom->nlocal; i++) set_arrays(i);
 
   if (narg == 3) {
     carrier_rho = 0;
   }
   else if (narg == 4) {
-    carrier_rho = atoi(arg[3]);
+    carrier_rho = atof(arg[3]);
   }
 }
 
@@ -78,31 +87,6 @@ int FixFluidDrag::setmask()
 
 /* ---------------------------------------------------------------------- */
 
-void FixFluidDrag::init()
-{
-  int nlocal = atom->nlocal;
-  int *mask = atom->mask;
-  for (int i = 0; i < nlocal; i++){
-    if (mask[i] & groupbit) {
-      ffluiddrag[i][0] = 0.;
-      ffluiddrag[i][1] = 0.;
-      ffluiddrag[i][2] = 0.;
-
-      DuDt[i][0] = 0.;
-      DuDt[i][1] = 0.;
-      DuDt[i][2] = 0.;
-
-      foamCpuId[i] = 0;
-
-      vOld[i][0] = 0.;
-      vOld[i][1] = 0.;
-      vOld[i][2] = 0.;
-    }
-  }
-}
-
-/* ---------------------------------------------------------------------- */
-
 void FixFluidDrag::setup(int vflag)
 {
   if (strcmp(update->integrate_style,"verlet") == 0)
@@ -118,47 +102,37 @@ void FixFluidDrag::post_force(int vflag)
   int *mask = atom->mask;
   int nlocal = atom->nlocal;
 
-  double timeStep = update->dt;
-  double rho = 0.;
-  double accX = 0.;
-  double accY = 0.;
-  double accZ = 0.;
+  if (carrier_rho == 0.) {
+    for (int i = 0; i < nlocal; i++) {
+      if (mask[i] & groupbit) {
+        f[i][0] += ffluiddrag[i][0];
+        f[i][1] += ffluiddrag[i][1];
+        f[i][2] += ffluiddrag[i][2];
+      }
+    }
+    return;
+  }
 
+  // drag + added mass 0.5*carrier_rho*Vol*(DuDt - dv/dt) in one pass
   double **v = atom->v;
-  // get the mass of particles
-  double *rmass = atom->rmass;
   double *r = atom->radius;
+  double dtinv = 1.0/update->dt;
+  double coeff = 0.5*carrier_rho*4.0*MY_PI/3.0;
 
-  // printf("++++=A> deltaT is: %10f, Vx = %10f, Vy = %10f, Vz = %10f\n", timeStep, v[0][0], v[0][1], v[0][2]);
-  // printf("++++=A> deltaT is: %10f, VxOld = %10f, VyOld = %10f, VzOld = %10f\n", timeStep, vOld[0][0], vOld[0][1], vOld[0][2]);
-
-  // printf("++++=A> deltaT is: %10f, Ax = %10f, Ay = %10f, Az = %10f\n", timeStep, 
-  //       ((v[0][0] - vOld[0][0])/timeStep),
-  //       ((v[0][1] - vOld[0][1])/timeStep),
-  //       ((v[0][2] - vOld[0][2])/timeStep));
-  // int myrank;
-  // MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
-
-  // printf("++++=A> myrank = %5d, nlocal = %5d, nghost = %5d,
-  //    ndrag = %5d\n", myrank, nlocal, nghost, ndrag);
   for (int i = 0; i < nlocal; i++) {
     if (mask[i] & groupbit) {
-
-       rho = 3.0*rmass[i]/(4.0*3.14159265358917323846*r[i]*r[i]*r[i]);
-       accX = ((v[i][0] - vOld[i][0])/timeStep),
-       accY = ((v[i][1] - vOld[i][1])/timeStep),
-       accZ = ((v[i][2] - vOld[i][2])/timeStep),
-
-       f[i][0] += ffluiddrag[i][0] + 
-                  carrier_rho/rho*0.5*rmass[i]*(DuDt[i][0] - accX);
-       f[i][1] += ffluiddrag[i][1] +
-                  carrier_rho/rho*0.5*rmass[i]*(DuDt[i][1] - accY);
-       f[i][2] += ffluiddrag[i][2] +
-                  carrier_rho/rho*0.5*rmass[i]*(DuDt[i][2] - accZ);
-
-       vOld[i][0] = v[i][0];
-       vOld[i][1] = v[i][1];
-       vOld[i][2] = v[i][2];
+      double cm = coeff*r[i]*r[i]*r[i];
+
+      f[i][0] += ffluiddrag[i][0] +
+                 cm*(DuDt[i][0] - (v[i][0] - vOld[i][0])*dtinv);
+      f[i][1] += ffluiddrag[i][1] +
+                 cm*(DuDt[i][1] - (v[i][1] - vOld[i][1])*dtinv);
+      f[i][2] += ffluiddrag[i][2] +
+                 cm*(DuDt[i][2] - (v[i][2] - vOld[i][2])*dtinv);
+
+      vOld[i][0] = v[i][0];
+      vOld[i][1] = v[i][1];
+      vOld[i][2] = v[i][2];
     }
   }
 }
@@ -204,6 +178,18 @@ void FixFluidDrag::copy_arrays(int i, int j, int delflag)
   vOld[j][2] = vOld[i][2];
 }
 
+/* ----------------------------------------------------------------------
+   initialize one atom's array values, called when atom is created
+------------------------------------------------------------------------- */
+
+void FixFluidDrag::set_arrays(int i)
+{
+  ffluiddrag[i][0] = ffluiddrag[i][1] = ffluiddrag[i][2] = 0.0;
+  DuDt[i][0] = DuDt[i][1] = DuDt[i][2] = 0.0;
+  foamCpuId[i] = 0;
+  vOld[i][0] = vOld[i][1] = vOld[i][2] = 0.0;
+}
+
 /* ----------------------------------------------------------------------
    pack values in local atom-based array for exchange with another proc
 ------------------------------------------------------------------------- */
@@ -36,13 +36,15 @@ class FixFluidDrag : public Fix {
   ~FixFluidDrag();
 
   int setmask();
-  void init();
   void setup(int);
   virtual void post_force(int);
 
+  double get_carrier_rho() { return carrier_rho; }
+
   double memory_usage();
   void grow_arrays(int);
   void copy_arrays(int, int, int);
+  void set_arrays(int);
   int pack_exchange(int, double *);
   int unpack_exchange(int, double *);
 
@@ -71,8 +71,9 @@ FixWallGranFix::FixWallGranFix(LAMMPS *lmp, int narg, char **arg) :
     error->all(FLERR,"Illegal fix wall/granFix command");
 
   // convert Kn and Kt from pressure units to force/distance^2 if Hertzian
+  // (gran/hertzFix/history and gran/hertzFix/history/omp)
 
-  if (force->pair_match("gran/hertzFix/history",1)) {
+  if (force->pair_match("gran/hertzFix/history",0)) {
     kn /= force->nktv2p;
     kt /= force->nktv2p;
   }
@@ -246,7 +247,7 @@ void FixWallGranFix::setup(int vflag)
 
 void FixWallGranFix::post_force(int vflag)
 {
-  double vwall[3],dx,dy,dz,del1,del2,delxy,delr,rsq;
+  double vwall[3];
 
   // set position of wall to initial settings and velocity to 0.0
   // if wiggle or shear, set wall position and velocity accordingly
@@ -286,9 +287,21 @@ void FixWallGranFix::post_force(int vflag)
   shearupdate = 1;
   if (update->setupflag) shearupdate = 0;
 
+  // atoms are independent: each thread updates f, torque and shear of
+  // its own atoms, the rotating cylinder sets a per-atom wall velocity
+
+#if defined(_OPENMP)
+#pragma omp parallel for default(shared) schedule(static)
+#endif
   for (int i = 0; i < nlocal; i++) {
     if (mask[i] & groupbit) {
 
+      double dx,dy,dz,del1,del2,delxy,delr,rsq;
+      double vw[3];
+      vw[0] = vwall[0];
+      vw[1] = vwall[1];
+      vw[2] = vwall[2];
+
       dx = dy = dz = 0.0;
 
       if (wallstyle == XPLANE) {
@@ -314,9 +327,9 @@ void FixWallGranFix::post_force(int vflag)
           dx = -delr/delxy * x[i][0];
           dy = -delr/delxy * x[i][1];
           if (wshear && axis != 2) {
-            vwall[0] = vshear * x[i][1]/delxy;
-            vwall[1] = -vshear * x[i][0]/delxy;
-            vwall[2] = 0.0;
+            vw[0] = vshear * x[i][1]/delxy;
+            vw[1] = -vshear * x[i][0]/delxy;
+            vw[2] = 0.0;
           }
         }
       }
@@ -331,13 +344,13 @@ void FixWallGranFix::post_force(int vflag)
         }
       } else {
         if (pairstyle == HOOKE)
-          hooke(rsq,dx,dy,dz,vwall,v[i],f[i],omega[i],torque[i],
+          hooke(rsq,dx,dy,dz,vw,v[i],f[i],omega[i],torque[i],
                 radius[i],rmass[i]);
         else if (pairstyle == HOOKE_HISTORY)
-          hooke_history(rsq,dx,dy,dz,vwall,v[i],f[i],omega[i],torque[i],
+          hooke_history(rsq,dx,dy,dz,vw,v[i],f[i],omega[i],torque[i],
                         radius[i],rmass[i],shear[i]);
         else if (pairstyle == HERTZ_HISTORY)
-          hertz_history(rsq,dx,dy,dz,vwall,v[i],f[i],omega[i],torque[i],
+          hertz_history(rsq,dx,dy,dz,vw,v[i],f[i],omega[i],torque[i],
                         radius[i],rmass[i],shear[i]);
       }
     }
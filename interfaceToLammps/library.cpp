@@ -31,6 +31,11 @@
 #include "memory.h"
 #include "group.h"
 #include "domain.h"
+#include "timer.h"
+#include "force.h"
+#include "fix.h"
+#include "pair.h"
+#include "pair_gran_hertzFix_history.h"
 
 using namespace LAMMPS_NS;
 
@@ -271,22 +276,7 @@ void lammps_get_local_info(void* ptr, double* coords_, double* velos_,
   int *type = lammps->atom->type;
   int nlocal = lammps->atom->nlocal;
 
-
-  double *copyx = new double[3*nlocal];
-  double *copyv = new double[3*nlocal];
-  int *copyfoamCpuId = new int[nlocal];
-  int *copytag = new int[nlocal];
-
-  for (int i = 0; i < 3*nlocal; i++) {
-    copyx[i] = 0.0;
-    copyv[i] = 0.0;
-  }
-
-  for (int i = 0; i < nlocal; i++) {
-    copyfoamCpuId[i] = 0;
-    copytag[i] = 0;
-  }
-
+  // Copied straight into the arrays of the caller
   for (int i = 0; i < nlocal; i++) {
     coords_[3*i+0] = x[i][0];
     coords_[3*i+1] = x[i][1];
@@ -300,11 +290,6 @@ void lammps_get_local_info(void* ptr, double* coords_, double* velos_,
     lmpCpuId_[i] = myrank;
     tag_[i] = tag[i];
   }
-
-  delete [] copyx;
-  delete [] copyv;
-  delete [] copyfoamCpuId;
-  delete [] copytag;
 }
 
 
@@ -340,6 +325,38 @@ void lammps_put_local_info(void* ptr, int nLocalIn, double* fdrag,
     printf("Incoming drag is: %5d, local particle number is: %5d.", nLocalIn, nlocal);
   }
 
+  if (lammps->atom->map_style) {
+
+    // match the incoming tags with the tag->index map kept by LAMMPS
+    int nmissing = 0;
+    for (int j = 0; j < nLocalIn; j++) {
+
+      int tolmpid = lammps->atom->map(tagIn[j]);
+
+      if (tolmpid < 0 || tolmpid >= nlocal) {
+        nmissing++;
+        continue;
+      }
+
+      drag_ptr->foamCpuId[tolmpid] = foamCpuIdIn[j];
+
+      drag_ptr->ffluiddrag[tolmpid][0] = fdrag[3*j+0];
+      drag_ptr->ffluiddrag[tolmpid][1] = fdrag[3*j+1];
+      drag_ptr->ffluiddrag[tolmpid][2] = fdrag[3*j+2];
+
+      drag_ptr->DuDt[tolmpid][0] = DuDt[3*j+0];
+      drag_ptr->DuDt[tolmpid][1] = DuDt[3*j+1];
+      drag_ptr->DuDt[tolmpid][2] = DuDt[3*j+2];
+    }
+
+    if (nmissing) {
+      printf("Incoming drag of %5d particles not found locally.\n", nmissing);
+    }
+
+    return;
+  }
+
+  // no atom map defined: sort both tag lists to match them
   //initialize the tag pair to sort
   std::vector<tagpair> lmptagpair (nlocal);
   std::vector<tagpair> intagpair (nlocal);
@@ -363,6 +380,108 @@ void lammps_put_local_info(void* ptr, int nLocalIn, double* fdrag,
     drag_ptr->ffluiddrag[tolmpid][0] = fdrag[3*fromfoamid+0];
     drag_ptr->ffluiddrag[tolmpid][1] = fdrag[3*fromfoamid+1];
     drag_ptr->ffluiddrag[tolmpid][2] = fdrag[3*fromfoamid+2];
+
+    drag_ptr->DuDt[tolmpid][0] = DuDt[3*fromfoamid+0];
+    drag_ptr->DuDt[tolmpid][1] = DuDt[3*fromfoamid+1];
+    drag_ptr->DuDt[tolmpid][2] = DuDt[3*fromfoamid+2];
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+// Find the fix fluid drag; the caller keeps the handle
+void* lammps_get_fluid_drag(void* ptr)
+{
+  LAMMPS *lammps = (LAMMPS *) ptr;
+
+  for (int i = 0; i < (lammps->modify->nfix); i++)
+    if (strcmp(lammps->modify->fix[i]->style,"fdrag") == 0)
+      return (void *) lammps->modify->fix[i];
+
+  return NULL;
+}
+
+
+/* ---------------------------------------------------------------------- */
+// Carrier fluid density given to the fix fluid drag
+double lammps_get_carrier_rho(void* dragFix)
+{
+  FixFluidDrag *drag_ptr = (FixFluidDrag *) dragFix;
+  return drag_ptr->get_carrier_rho();
+}
+
+
+/* ---------------------------------------------------------------------- */
+// Expose the local per-atom arrays for packing/unpacking in place.
+// Note: No copy occurs! The arrays are allocated contiguously by
+// memory->create/grow, so x[0] etc. hold 3*nmax doubles.
+int lammps_borrow_local_arrays(void* ptr, void* dragFix, double** x,
+                               double** v, int** tag, double** fdrag,
+                               double** DuDt, int** foamCpuId)
+{
+  LAMMPS *lammps = (LAMMPS *) ptr;
+  FixFluidDrag *drag_ptr = (FixFluidDrag *) dragFix;
+
+  int nlocal = lammps->atom->nlocal;
+
+  if (lammps->atom->nmax == 0) {
+    *x = NULL;
+    *v = NULL;
+    *tag = NULL;
+    *fdrag = NULL;
+    *DuDt = NULL;
+    *foamCpuId = NULL;
+    return nlocal;
+  }
+
+  *x = lammps->atom->x[0];
+  *v = lammps->atom->v[0];
+  *tag = lammps->atom->tag;
+  *fdrag = drag_ptr->ffluiddrag[0];
+  *DuDt = drag_ptr->DuDt[0];
+  *foamCpuId = drag_ptr->foamCpuId;
+
+  return nlocal;
+}
+
+
+/* ---------------------------------------------------------------------- */
+// Local index of each incoming tag, through the atom map if defined
+void lammps_map_tags(void* ptr, int n, int* tagIn, int* indexOut)
+{
+  LAMMPS *lammps = (LAMMPS *) ptr;
+
+  int *tag = lammps->atom->tag;
+  int nlocal = lammps->atom->nlocal;
+
+  if (lammps->atom->map_style) {
+    for (int j = 0; j < n; j++) {
+      int i = lammps->atom->map(tagIn[j]);
+      indexOut[j] = (i >= 0 && i < nlocal) ? i : -1;
+    }
+    return;
+  }
+
+  // no atom map defined: binary search in the sorted local tags
+  std::vector<tagpair> lmptagpair (nlocal);
+  for (int i = 0; i < nlocal; i++) {
+    lmptagpair[i].tag = tag[i];
+    lmptagpair[i].index = i;
+  }
+
+  std::sort(lmptagpair.begin(), lmptagpair.end(), by_number());
+
+  for (int j = 0; j < n; j++) {
+    tagpair key;
+    key.tag = tagIn[j];
+    key.index = -1;
+
+    std::vector<tagpair>::iterator it =
+      std::lower_bound(lmptagpair.begin(), lmptagpair.end(), key, by_number());
+
+    if (it != lmptagpair.end() && it->tag == tagIn[j])
+      indexOut[j] = it->index;
+    else
+      indexOut[j] = -1;
   }
 }
 
@@ -387,6 +506,31 @@ void lammps_step(void *ptr, int n)
 
 /* ---------------------------------------------------------------------- */
 
+// Time spent on forces and neighbor lists in the last run by this proc
+// (communication and waiting for other procs are not included)
+double lammps_get_compute_time(void *ptr)
+{
+  LAMMPS *lammps = (LAMMPS *) ptr;
+  double *array = lammps->timer->array;
+
+  return array[TIME_PAIR] + array[TIME_BOND] + array[TIME_KSPACE] +
+    array[TIME_NEIGHBOR];
+}
+
+/* ---------------------------------------------------------------------- */
+
+// Run a balance command, then a setup to rebuild ghosts and neighbor
+// lists for the new sub-domains before the next "run pre no"
+void lammps_rebalance(void *ptr, char *cmd)
+{
+  LAMMPS *lammps = (LAMMPS *) ptr;
+
+  lammps->input->one(cmd);
+  lammps->input->one("run 0 post no");
+}
+
+/* ---------------------------------------------------------------------- */
+
 double lammps_get_timestep(void *ptr)
 {
    LAMMPS *lammps = (LAMMPS *) ptr;
@@ -395,200 +539,225 @@ double lammps_get_timestep(void *ptr)
 
 /* ---------------------------------------------------------------------- */
 
+// Change the timestep between runs: "run pre no" skips init(), so the
+// fixes (nve/sphere dtv/dtf, granular walls) and the pair style refresh
+// the dt they cached through reset_dt(), as for the timestep command
 void lammps_set_timestep(void *ptr, double dt_i)
 {
   LAMMPS *lammps = (LAMMPS *) ptr;
+
+  if (lammps->update->dt == dt_i) return;
+
   lammps->update->dt = dt_i;
+
+  for (int i = 0; i < lammps->modify->nfix; i++)
+    lammps->modify->fix[i]->reset_dt();
+  if (lammps->force->pair) lammps->force->pair->reset_dt();
 }
 
 /* ---------------------------------------------------------------------- */
 
-void lammps_create_particle(void* ptr, int npAdd, double* position, double* tag, 
-                            double diameter, double rho, int type, double* vel)
+// 1 if the pair style reports the gap of the neighbor pairs
+// (gran/hertzFix/history and its /omp variant), 0 otherwise
+int lammps_has_min_gap(void *ptr)
 {
+  LAMMPS *lammps = (LAMMPS *) ptr;
 
-  int myrank;
-  MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
+  return (lammps->force->pair_match("gran/hertzFix/history",0) != NULL);
+}
+
+/* ---------------------------------------------------------------------- */
 
+// Smallest (r - radsum)/radsum of the neighbor pairs in the last step on
+// this proc (negative: overlap); -1.0 (contact assumed) if the pair
+// style cannot report it
+double lammps_get_min_gap(void *ptr)
+{
   LAMMPS *lammps = (LAMMPS *) ptr;
 
-  int natom = static_cast<int> (lammps->atom->natoms);
-  double **x = lammps->atom->x;
-  int ntype = type;
-  double *xNew = new double[2];
+  Pair *pair = lammps->force->pair_match("gran/hertzFix/history",0);
+  if (pair == NULL) return -1.0;
 
-  tagint max = 0;
-  tagint maxtag_all = 0;
+  return ((PairGranHertzFixHistory *) pair)->mingap;
+}
 
-  tagint *tagOld = lammps->atom->tag;
-  for (int i = 0; i < lammps->atom->nlocal; i++) max = MAX(max,tagOld[i]);
-  // MPI_Allreduce(&max,&maxtag_all,1,MPI_LMP_TAGINT,MPI_MAX,lammps->world);
+/* ---------------------------------------------------------------------- */
 
-  for (int m = 0; m < npAdd; m++) {
-    xNew[0] = position[0+m*3];
-    xNew[1] = position[1+m*3];
-    xNew[2] = position[2+m*3];
-
-    lammps->atom->avec->create_atom(ntype,xNew);
-    int nlocal = lammps->atom->nlocal;
-
-    int n = lammps->atom->nlocal - 1;
-    // lammps->atom->tag[n] = maxtag_all + 1;
-    lammps->atom->tag[n] = tag[m];
- 
-    // // Setting PBC?
-    // for (int i = 0; i < nlocal; i++) {
-    //   double delx = xNew[0] - x[i][0];
-    //   double dely = xNew[1] - x[i][1];
-    //   double delz = xNew[2] - x[i][2];
-    //   lammps->domain->minimum_image(delx,dely,delz);
-    // }
-
-    // TODO: may have problem here
-    int igroup = lammps->group->find("active");
-    int groupbit = lammps->group->bitmask[igroup];
-
-    lammps->atom->mask[n] = 1 | groupbit;
-    lammps->atom->image[n] = ((imageint) IMGMAX << IMG2BITS) |
-                             ((imageint) IMGMAX << IMGBITS) | IMGMAX;
-    lammps->atom->v[n][0] = vel[0];
-    lammps->atom->v[n][1] = vel[1];
-    lammps->atom->v[n][2] = vel[2];
-
-    double radtmp = 0.5*diameter;
-    lammps->atom->radius[n] = radtmp;
-    lammps->atom->rmass[n] = 4.0*3.14159265358917323846/3.0 * radtmp*radtmp*radtmp * rho;
-
-    for (int j = 0; j < lammps->modify->nfix; j++)
-    {
-      if (lammps->modify->fix[j]->create_attribute)
-      {
-          lammps->modify->fix[j]->set_arrays(n);
-      }
-    }
-  }
+// Create n atoms on this proc from per-atom arrays (x and v: 3 per atom)
+// tag[m] < 1 (or tag NULL) gets a new tag after the largest tag in use,
+// numbered across procs by a single prefix sum, and written back to tag
+// all procs call it, n may be 0
 
-  int nGlobal = 0;
-  int nlocal = lammps->atom->nlocal;
-  MPI_Allreduce(&nlocal,&nGlobal,1,MPI_INT,MPI_SUM,lammps->world);
-  lammps->atom->natoms = nGlobal;
+void lammps_create_particles(void* ptr, int n, double* x, double* v,
+                             double* diameter, double* rho, int* type,
+                             int* tag)
+{
+  LAMMPS *lammps = (LAMMPS *) ptr;
+  Atom *atom = lammps->atom;
 
-  if (lammps->atom->map_style) {
-    lammps->atom->nghost = 0;
-    lammps->atom->map_init();
-    lammps->atom->map_set();
-  }
+  int i,j,m;
 
-  for (int j = 0; j < lammps->modify->nfix; j++)
-  {
-    bigint nt = lammps->update->ntimestep;
-    lammps->modify->fix[j]->next_reneighbor = nt + 1;
+  // total # of atoms and of new tags in one reduction
+
+  bigint nme[2],nall[2];
+  nme[0] = n;
+  nme[1] = 0;
+  for (m = 0; m < n; m++)
+    if (!tag || tag[m] < 1) nme[1]++;
+
+  MPI_Allreduce(nme,nall,2,MPI_LMP_BIGINT,MPI_SUM,lammps->world);
+
+  if (nall[0] == 0) return;
+
+  // new tags: max tag in use + # of new tags on procs before me
+
+  tagint nexttag = 0;
+
+  if (nall[1]) {
+    tagint maxtag = 0;
+    for (i = 0; i < atom->nlocal; i++) maxtag = MAX(maxtag,atom->tag[i]);
+    if (tag)
+      for (m = 0; m < n; m++) maxtag = MAX(maxtag,tag[m]);
+
+    tagint maxtag_all;
+    MPI_Allreduce(&maxtag,&maxtag_all,1,MPI_LMP_TAGINT,MPI_MAX,lammps->world);
+
+    bigint nbefore;
+    MPI_Scan(&nme[1],&nbefore,1,MPI_LMP_BIGINT,MPI_SUM,lammps->world);
+    nbefore -= nme[1];
+
+    nexttag = maxtag_all + nbefore + 1;
   }
 
-  delete [] xNew;
+  int igroup = lammps->group->find("active");
+  int groupbit = (igroup >= 0) ? lammps->group->bitmask[igroup] : 0;
 
-}
+  // reserve the storage of the whole batch at once
 
-void lammps_delete_particle(void *ptr, int* deleteList, int nDelete)
-{
-  int myrank;
-  MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
+  if (atom->nlocal + n > atom->nmax) atom->avec->grow(atom->nlocal + n);
 
-  LAMMPS *lammps = (LAMMPS *) ptr;
-  class RanPark *random = new RanPark(lammps,100);
+  double radtmp;
+
+  for (m = 0; m < n; m++) {
+    atom->avec->create_atom(type[m],&x[3*m]);
 
-  int i,j,m,iwhichglobal,iwhichlocal;
-  int ndel,ndeltopo[4];
-  int *list,*mark;
+    i = atom->nlocal - 1;
 
-  // grow list and mark arrays if necessary
+    if (!tag || tag[m] < 1) {
+      atom->tag[i] = nexttag++;
+      if (tag) tag[m] = atom->tag[i];
+    } else atom->tag[i] = tag[m];
 
-  int nmax = 0;
-  if (lammps->atom->nlocal > nmax) {
-    lammps->memory->destroy(list);
-    lammps->memory->destroy(mark);
-    nmax = lammps->atom->nmax;
-    lammps->memory->create(list,nmax,"evaporate:list");
-    lammps->memory->create(mark,nmax,"evaporate:mark");
+    atom->mask[i] = 1 | groupbit;
+    atom->image[i] = ((imageint) IMGMAX << IMG2BITS) |
+                     ((imageint) IMGMAX << IMGBITS) | IMGMAX;
+    atom->v[i][0] = v[3*m];
+    atom->v[i][1] = v[3*m+1];
+    atom->v[i][2] = v[3*m+2];
+
+    radtmp = 0.5*diameter[m];
+    atom->radius[i] = radtmp;
+    atom->rmass[i] = 4.0*MathConst::MY_PI/3.0 * radtmp*radtmp*radtmp * rho[m];
+
+    for (j = 0; j < lammps->modify->nfix; j++)
+      if (lammps->modify->fix[j]->create_attribute)
+        lammps->modify->fix[j]->set_arrays(i);
   }
 
-  // ncount = # of deletable atoms in region that I own
-  // nall = # on all procs // nbefore = # on procs before me
-  // list[ncount] = list of local indices of atoms I can delete
+  atom->natoms += nall[0];
 
-  double **x = lammps->atom->x;
-  int *mask = lammps->atom->mask;
-  tagint *tag = lammps->atom->tag;
-  int nlocal = lammps->atom->nlocal;
+  // rebuild the map and reneighbor once for the batch
 
-  int ncount = 0;
+  if (atom->map_style) {
+    atom->nghost = 0;
+    atom->map_init();
+    atom->map_set();
+  }
 
-  for (i = 0; i < nlocal; i++)
+  for (j = 0; j < lammps->modify->nfix; j++)
   {
-    for (j = 0; j < nDelete; j++)
-    {
-       if (deleteList[j] == tag[i]) // delete the particle when assigned in openfoam
-       {
-           list[ncount++] = i;
-       }
-    }
+    bigint nt = lammps->update->ntimestep;
+    lammps->modify->fix[j]->next_reneighbor = nt + 1;
   }
+}
 
-  int nall,nbefore;
-  MPI_Allreduce(&ncount,&nall,1,MPI_INT,MPI_SUM,lammps->world);
+/* ---------------------------------------------------------------------- */
+
+// Create atoms sharing one diameter, density, type and velocity
+void lammps_create_particle(void* ptr, int npAdd, double* position, double* tag, 
+                            double diameter, double rho, int type, double* vel)
+{
+  int nmem = (npAdd > 0) ? npAdd : 1;
+  std::vector<double> v(3*nmem), d(nmem), r(nmem);
+  std::vector<int> t(nmem), tags(nmem);
+
+  for (int m = 0; m < npAdd; m++) {
+    v[3*m] = vel[0];
+    v[3*m+1] = vel[1];
+    v[3*m+2] = vel[2];
+    d[m] = diameter;
+    r[m] = rho;
+    t[m] = type;
+    tags[m] = static_cast<int> (tag[m]);
+  }
+
+  lammps_create_particles(ptr, npAdd, position, &v[0], &d[0], &r[0], &t[0],
+                          &tags[0]);
+}
 
-  MPI_Scan(&ncount,&nbefore,1,MPI_INT,MPI_SUM,lammps->world);
-  nbefore -= ncount;
+void lammps_delete_particle(void *ptr, int* deleteList, int nDelete)
+{
+  LAMMPS *lammps = (LAMMPS *) ptr;
 
-  // ndel = total # of atom deletions, in or out of region
-  // ndeltopo[1,2,3,4] = ditto for bonds, angles, dihedrals, impropers
-  // mark[] = 1 if deleted
+  int i,j;
+  int nlocal = lammps->atom->nlocal;
 
-  ndel = 0;
+  // local index of each tag to delete (-1 if owned by another proc)
+  // tags < 1 are not atoms and are skipped before the lookup
 
-  for (i = 0; i < nlocal; i++) mark[i] = 0;
+  std::vector<int> tagIn;
+  tagIn.reserve(nDelete);
+  for (j = 0; j < nDelete; j++)
+    if (deleteList[j] > 0) tagIn.push_back(deleteList[j]);
 
-  double flux = nDelete;
+  int nIn = tagIn.size();
+  std::vector<int> index(nIn > 0 ? nIn : 1, -1);
+  if (nIn) lammps_map_tags(ptr, nIn, &tagIn[0], &index[0]);
 
-  double totalFlux = 0;
-  MPI_Allreduce(&flux,&totalFlux,1,MPI_DOUBLE,MPI_SUM,lammps->world);
+  // mark[] = 1 if deleted; each tag is deleted once even if listed twice
+  // the exact tag set is known, so all of them are deleted
 
-  totalFlux -= 0.5;
+  std::vector<char> mark(nlocal > 0 ? nlocal : 1, 0);
+  int ndelme = 0;
 
-  while (nall && ndel < totalFlux) {
-    iwhichglobal = static_cast<int> (nall*random->uniform());
-    if (iwhichglobal < nbefore)
-    {
-      nbefore--;
-    }
-    else if (iwhichglobal < nbefore + ncount)
-    {
-      iwhichlocal = iwhichglobal - nbefore;
-      mark[list[iwhichlocal]] = 1;
-      list[iwhichlocal] = list[ncount-1];
-      ncount--;
+  for (j = 0; j < nIn; j++) {
+    i = index[j];
+    if (i >= 0 && !mark[i]) {
+      mark[i] = 1;
+      ndelme++;
     }
-    ndel++;
-    nall--;
   }
 
-  // atomic deletions
-  // choose atoms randomly across all procs and mark them for deletion
-  // shrink eligible list as my atoms get marked
-  // keep ndel,ncount,nall,nbefore current after each atom deletion
-
   // delete my marked atoms
   // loop in reverse order to avoid copying marked atoms
 
   AtomVec *avec = lammps->atom->avec;
 
-  for (i = nlocal-1; i >= 0; i--) {
-    if (mark[i]) {
-      avec->copy(lammps->atom->nlocal-1,i,1);
-      lammps->atom->nlocal--;
+  if (ndelme) {
+    for (i = nlocal-1; i >= 0; i--) {
+      if (mark[i]) {
+        avec->copy(lammps->atom->nlocal-1,i,1);
+        lammps->atom->nlocal--;
+      }
     }
   }
 
+  // ndel = total # of atom deletions, in a single reduction
+
+  bigint ndelmebig = ndelme;
+  bigint ndel;
+  MPI_Allreduce(&ndelmebig,&ndel,1,MPI_LMP_BIGINT,MPI_SUM,lammps->world);
+
   // reset global natoms and bonds, angles, etc
   // if global map exists, reset it now instead of waiting for comm
   // since deleting atoms messes up ghosts
@@ -601,15 +770,10 @@ void lammps_delete_particle(void *ptr, int* deleteList, int nDelete)
     lammps->atom->map_set();
   }
 
-  // // statistics
-  for (int j = 0; j < lammps->modify->nfix; j++)
+  // reneighbor on the next step
+  for (j = 0; j < lammps->modify->nfix; j++)
   {
     bigint nt = lammps->update->ntimestep;
     lammps->modify->fix[j]->next_reneighbor = nt + 1;
-    // lammps->modify->fix[j]->force_reneighbor = 1;
   }
-
-  // ndeleted += ndel;
-  // next_reneighbor = update->ntimestep + nevery;
-  // delete [] random;
 }
@@ -55,14 +55,53 @@ extern "C" {
   void lammps_put_local_info(void* ptr, int nLocalIn, double* fdrag, 
                              double* DuDt, int* foamCpuIdIn, int* tagIn);
 
+  /* return the fix fluid drag (NULL if not defined); look it up once */
+  void* lammps_get_fluid_drag(void* ptr);
+
+  /* carrier fluid density used by the fix for the added mass (0: off) */
+  double lammps_get_carrier_rho(void* dragFix);
+
+  /* borrow the local per-atom storage of LAMMPS and of the fix fluid drag
+     (3 doubles per atom for x, v, fdrag, DuDt); returns nlocal.
+     Pointers are valid until atoms are stepped, added or deleted */
+  int lammps_borrow_local_arrays(void* ptr, void* dragFix, double** x,
+                                 double** v, int** tag, double** fdrag,
+                                 double** DuDt, int** foamCpuId);
+
+  /* local atom index of each tag (-1 if not owned by this proc) */
+  void lammps_map_tags(void* ptr, int n, int* tagIn, int* indexOut);
+
   void lammps_step(void* ptr, int n);
+
+  /* 1 if the pair style reports the gap of the neighbor pairs */
+  int lammps_has_min_gap(void* ptr);
+
+  /* smallest relative gap of the neighbor pairs in the last step,
+     negative (contact) if the pair style cannot report it */
+  double lammps_get_min_gap(void* ptr);
+
+  /* force and neighbor time of the last run on this proc */
+  double lammps_get_compute_time(void* ptr);
+
+  /* run the balance command cmd and set up the new sub-domains */
+  void lammps_rebalance(void* ptr, char* cmd);
+
   void lammps_set_timestep(void* ptr, double dt_i);
   double lammps_get_timestep(void* ptr);
+  /* create n atoms on this proc from per-atom position, velocity (3 per
+     atom), diameter, density and type; tag[m] < 1 (or tag NULL) gets a
+     new tag, written back to tag. All procs call it */
+  void lammps_create_particles(void* ptr, int n, double* x, double* v,
+                               double* diameter, double* rho, int* type,
+                               int* tag);
   void lammps_create_particle(void* ptr, int npAdd, double* position, double* tag, 
                               double diameter, double rho, int type, double* vel);
+  /* delete the atoms of the given tags (all procs call it; each deletes
+     the ones it owns, tags < 1 are ignored) */
   void lammps_delete_particle(void* ptr, int* deleteList, int nDelete);
 
-  /* used in the sorting part when assigning data from OpenFOAM*/
+  /* used in the sorting part when assigning data from OpenFOAM
+     (only when no atom map is defined in LAMMPS) */
   struct tagpair {
     int tag;
     int index;
@@ -35,10 +35,15 @@
 using namespace LAMMPS_NS;
 using namespace MathConst;
 
+#define BIG 1.0e20
+
 /* ---------------------------------------------------------------------- */
 
 PairGranHertzFixHistory::PairGranHertzFixHistory(LAMMPS *lmp) :
-  PairGranHookeHistory(lmp) {}
+  PairGranHookeHistory(lmp)
+{
+  mingap = BIG;
+}
 
 /* ---------------------------------------------------------------------- */
 
@@ -104,6 +109,10 @@ void PairGranHertzFixHistory::compute(int eflag, int vflag)
   firsttouch = list->listgranhistory->firstneigh;
   firstshear = list->listgranhistory->firstdouble;
 
+  // smallest rsq/radsum^2 over all neighbor pairs, for mingap
+
+  double ratiomin = BIG;
+
   // loop over neighbors of my atoms
 
   for (ii = 0; ii < inum; ii++) {
@@ -128,6 +137,8 @@ void PairGranHertzFixHistory::compute(int eflag, int vflag)
       radj = radius[j];
       radsum = radi + radj;
 
+      if (rsq < ratiomin*radsum*radsum) ratiomin = rsq/(radsum*radsum);
+
       if (rsq >= radsum*radsum) {
 
         // unset non-touching neighbors
@@ -284,6 +295,8 @@ void PairGranHertzFixHistory::compute(int eflag, int vflag)
       }
     }
   }
+
+  mingap = (ratiomin < BIG) ? sqrt(ratiomin) - 1.0 : BIG;
 }
 
 /* ----------------------------------------------------------------------
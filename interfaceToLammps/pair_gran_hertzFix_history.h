@@ -30,6 +30,8 @@ class PairGranHertzFixHistory : public PairGranHookeHistory {
   virtual void compute(int, int);
   void settings(int, char **);
   double single(int, int, int, int, double, double, double, double &);
+
+  double mingap;  // smallest (r - radsum)/radsum of the last compute
 };
 
 }
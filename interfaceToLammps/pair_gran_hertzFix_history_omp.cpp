@@ -0,0 +1,461 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------------
+   OpenMP version of pair gran/hertzFix/history
+------------------------------------------------------------------------- */
+
+#include "math.h"
+#include "stdlib.h"
+#include "string.h"
+#include "pair_gran_hertzFix_history_omp.h"
+#include "atom.h"
+#include "update.h"
+#include "force.h"
+#include "fix.h"
+#include "neighbor.h"
+#include "neigh_list.h"
+#include "comm.h"
+#include "memory.h"
+#include "error.h"
+#include "math_const.h"
+
+#if defined(_OPENMP)
+#include "omp.h"
+#endif
+
+using namespace LAMMPS_NS;
+using namespace MathConst;
+
+#define BIG 1.0e20
+
+/* ---------------------------------------------------------------------- */
+
+PairGranHertzFixHistoryOMP::PairGranHertzFixHistoryOMP(LAMMPS *lmp) :
+  PairGranHertzFixHistory(lmp)
+{
+  nthreads = 0;
+  maxall = 0;
+  thr_f = NULL;
+  thr_torque = NULL;
+  maxjnum = 0;
+  thr_contact = NULL;
+  thr_rsq = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+PairGranHertzFixHistoryOMP::~PairGranHertzFixHistoryOMP()
+{
+  destroy_thread_arrays();
+}
+
+/* ---------------------------------------------------------------------- */
+
+void PairGranHertzFixHistoryOMP::compute(int eflag, int vflag)
+{
+  if (eflag || vflag) ev_setup(eflag,vflag);
+  else evflag = vflag_fdotr = 0;
+
+  // the tallies go into shared accumulators
+
+  if (evflag) {
+    PairGranHertzFixHistory::compute(eflag,vflag);
+    return;
+  }
+
+  computeflag = 1;
+  int shearupdate = 1;
+  if (update->setupflag) shearupdate = 0;
+
+  // update rigid body info for owned & ghost atoms if using FixRigid masses
+  // body[i] = which body atom I is in, -1 if none
+  // mass_body = mass of each rigid body
+
+  if (fix_rigid && neighbor->ago == 0) {
+    int tmp;
+    int *body = (int *) fix_rigid->extract("body",tmp);
+    double *mass_body = (double *) fix_rigid->extract("masstotal",tmp);
+    if (atom->nmax > nmax) {
+      memory->destroy(mass_rigid);
+      nmax = atom->nmax;
+      memory->create(mass_rigid,nmax,"pair:mass_rigid");
+    }
+    int nlocal = atom->nlocal;
+    for (int i = 0; i < nlocal; i++)
+      if (body[i] >= 0) mass_rigid[i] = mass_body[body[i]];
+      else mass_rigid[i] = 0.0;
+    comm->forward_comm_pair(this);
+  }
+
+  const int nall = atom->nlocal + atom->nghost;
+  const int inum = list->inum;
+  int *ilist = list->ilist;
+  int *numneigh = list->numneigh;
+
+  int nthr = 1;
+#if defined(_OPENMP)
+  nthr = omp_get_max_threads();
+#endif
+
+  int jmax = 0;
+  for (int ii = 0; ii < inum; ii++)
+    if (numneigh[ilist[ii]] > jmax) jmax = numneigh[ilist[ii]];
+
+  grow_thread_arrays(nthr,nall,jmax);
+
+  double ratiomin = BIG;
+
+#if defined(_OPENMP)
+#pragma omp parallel default(shared) num_threads(nthr)
+#endif
+  {
+    int tid = 0;
+#if defined(_OPENMP)
+    tid = omp_get_thread_num();
+#endif
+
+    if (tid > 0) {
+      memset(&thr_f[tid-1][0][0],0,3*nall*sizeof(double));
+      memset(&thr_torque[tid-1][0][0],0,3*nall*sizeof(double));
+    }
+
+    // contiguous block of atoms I per thread
+
+    int chunk = (inum + nthr - 1) / nthr;
+    int ifrom = tid*chunk;
+    int ito = ifrom + chunk;
+    if (ifrom > inum) ifrom = inum;
+    if (ito > inum) ito = inum;
+
+    double ratiothr = eval(ifrom,ito,tid,shearupdate);
+
+#if defined(_OPENMP)
+#pragma omp critical
+#endif
+    if (ratiothr < ratiomin) ratiomin = ratiothr;
+
+    // sum the forces and torques of the other threads
+
+    if (nthr > 1) {
+#if defined(_OPENMP)
+#pragma omp barrier
+#pragma omp for schedule(static)
+#endif
+      for (int i = 0; i < nall; i++) {
+        for (int t = 0; t < nthr-1; t++) {
+          atom->f[i][0] += thr_f[t][i][0];
+          atom->f[i][1] += thr_f[t][i][1];
+          atom->f[i][2] += thr_f[t][i][2];
+          atom->torque[i][0] += thr_torque[t][i][0];
+          atom->torque[i][1] += thr_torque[t][i][1];
+          atom->torque[i][2] += thr_torque[t][i][2];
+        }
+      }
+    }
+  }
+
+  mingap = (ratiomin < BIG) ? sqrt(ratiomin) - 1.0 : BIG;
+}
+
+/* ----------------------------------------------------------------------
+   contact forces of atoms ilist[ifrom] to ilist[ito-1] on thread tid
+   return smallest rsq/radsum^2 of their neighbors
+------------------------------------------------------------------------- */
+
+double PairGranHertzFixHistoryOMP::eval(int ifrom, int ito, int tid,
+                                        int shearupdate)
+{
+  int i,j,ii,jj,kk,jnum,ncontact;
+  double xtmp,ytmp,ztmp,delx,dely,delz,fx,fy,fz;
+  double radi,radj,radsum,rsq,r,rinv,rsqinv;
+  double vr1,vr2,vr3,vnnr,vn1,vn2,vn3,vt1,vt2,vt3;
+  double wr1,wr2,wr3;
+  double vtr1,vtr2,vtr3;
+  double mi,mj,meff,damp,ccel,tor1,tor2,tor3;
+  double fn,fs,fs1,fs2,fs3;
+  double shrmag,rsht,polyhertz,tdamp;
+  int *jlist,*touch;
+  double *shear,*allshear;
+
+  double **x = atom->x;
+  double **v = atom->v;
+  double **f = (tid == 0) ? atom->f : thr_f[tid-1];
+  double **omega = atom->omega;
+  double **torque = (tid == 0) ? atom->torque : thr_torque[tid-1];
+  double *radius = atom->radius;
+  double *rmass = atom->rmass;
+  double *mass = atom->mass;
+  int *type = atom->type;
+  int *mask = atom->mask;
+  int nlocal = atom->nlocal;
+
+  int *ilist = list->ilist;
+  int *numneigh = list->numneigh;
+  int **firstneigh = list->firstneigh;
+  int **firsttouch = list->listgranhistory->firstneigh;
+  double **firstshear = list->listgranhistory->firstdouble;
+
+  int *contact = thr_contact[tid];
+  double *ratio = thr_rsq[tid];
+
+  // constants of the contact model, as in the serial compute
+
+  const double lng = log(gamman)/log(exp(1.0));
+  const double beta = -lng/sqrt(lng*lng + MY_PI*MY_PI);
+  const double cdamp = 2.0*sqrt(5.0/6.0)*beta;
+  const double snfac = 2.0*1.0/1.82*kn;
+  const double stfac = 8.0*1.0/8.84*kn;
+  const double knfac = 4.0/5.46*kn;
+  const double ktfac = 8.0/8.84*kt;
+
+  double ratiomin = BIG;
+
+  for (ii = ifrom; ii < ito; ii++) {
+    i = ilist[ii];
+    xtmp = x[i][0];
+    ytmp = x[i][1];
+    ztmp = x[i][2];
+    radi = radius[i];
+    touch = firsttouch[i];
+    allshear = firstshear[i];
+    jlist = firstneigh[i];
+    jnum = numneigh[i];
+
+    // rsq/radsum^2 of all the neighbors, no branches
+
+    for (jj = 0; jj < jnum; jj++) {
+      j = jlist[jj] & NEIGHMASK;
+      delx = xtmp - x[j][0];
+      dely = ytmp - x[j][1];
+      delz = ztmp - x[j][2];
+      radsum = radi + radius[j];
+      ratio[jj] = (delx*delx + dely*dely + delz*delz) / (radsum*radsum);
+    }
+
+    // touching neighbors, unset the others
+
+    ncontact = 0;
+    for (jj = 0; jj < jnum; jj++) {
+      if (ratio[jj] < ratiomin) ratiomin = ratio[jj];
+
+      if (ratio[jj] < 1.0) contact[ncontact++] = jj;
+      else {
+        touch[jj] = 0;
+        shear = &allshear[3*jj];
+        shear[0] = 0.0;
+        shear[1] = 0.0;
+        shear[2] = 0.0;
+      }
+    }
+
+    for (kk = 0; kk < ncontact; kk++) {
+      jj = contact[kk];
+      j = jlist[jj] & NEIGHMASK;
+
+      delx = xtmp - x[j][0];
+      dely = ytmp - x[j][1];
+      delz = ztmp - x[j][2];
+      rsq = delx*delx + dely*dely + delz*delz;
+      radj = radius[j];
+      radsum = radi + radj;
+
+      r = sqrt(rsq);
+      rinv = 1.0/r;
+      rsqinv = 1.0/rsq;
+
+      // relative translational velocity
+
+      vr1 = v[i][0] - v[j][0];
+      vr2 = v[i][1] - v[j][1];
+      vr3 = v[i][2] - v[j][2];
+
+      // normal component
+
+      vnnr = vr1*delx + vr2*dely + vr3*delz;
+      vn1 = delx*vnnr * rsqinv;
+      vn2 = dely*vnnr * rsqinv;
+      vn3 = delz*vnnr * rsqinv;
+
+      // tangential component
+
+      vt1 = vr1 - vn1;
+      vt2 = vr2 - vn2;
+      vt3 = vr3 - vn3;
+
+      // relative rotational velocity
+
+      wr1 = (radi*omega[i][0] + radj*omega[j][0]) * rinv;
+      wr2 = (radi*omega[i][1] + radj*omega[j][1]) * rinv;
+      wr3 = (radi*omega[i][2] + radj*omega[j][2]) * rinv;
+
+      // meff = effective mass of pair of particles
+      // if I or J part of rigid body, use body mass
+      // if I or J is frozen, meff is other particle
+
+      if (rmass) {
+        mi = rmass[i];
+        mj = rmass[j];
+      } else {
+        mi = mass[type[i]];
+        mj = mass[type[j]];
+      }
+      if (fix_rigid) {
+        if (mass_rigid[i] > 0.0) mi = mass_rigid[i];
+        if (mass_rigid[j] > 0.0) mj = mass_rigid[j];
+      }
+
+      meff = mi*mj / (mi+mj);
+      if (mask[i] & freeze_group_bit) meff = mj;
+      if (mask[j] & freeze_group_bit) meff = mi;
+
+      // normal force = Hertzian contact + normal velocity damping
+
+      polyhertz = sqrt((radsum-r)*radi*radj / radsum);
+      damp = cdamp*vnnr*rsqinv;
+      ccel = polyhertz*knfac*(radsum-r)*rinv - sqrt(snfac*polyhertz*meff)*damp;
+      tdamp = sqrt(stfac*polyhertz*meff)*cdamp;
+
+      // relative velocities
+
+      vtr1 = vt1 - (delz*wr2-dely*wr3);
+      vtr2 = vt2 - (delx*wr3-delz*wr1);
+      vtr3 = vt3 - (dely*wr1-delx*wr2);
+
+      // shear history effects
+
+      touch[jj] = 1;
+      shear = &allshear[3*jj];
+      if (shearupdate) {
+        shear[0] += vtr1*dt;
+        shear[1] += vtr2*dt;
+        shear[2] += vtr3*dt;
+      }
+      shrmag = sqrt(shear[0]*shear[0] + shear[1]*shear[1] +
+                    shear[2]*shear[2]);
+
+      // rotate shear displacements
+
+      rsht = shear[0]*delx + shear[1]*dely + shear[2]*delz;
+      rsht *= rsqinv;
+      if (shearupdate) {
+        shear[0] -= rsht*delx;
+        shear[1] -= rsht*dely;
+        shear[2] -= rsht*delz;
+      }
+
+      // tangential forces = shear + tangential velocity damping
+
+      fs1 = -polyhertz*ktfac*shear[0] - tdamp*vtr1;
+      fs2 = -polyhertz*ktfac*shear[1] - tdamp*vtr2;
+      fs3 = -polyhertz*ktfac*shear[2] - tdamp*vtr3;
+
+      // rescale frictional displacements and forces if needed
+
+      fs = sqrt(fs1*fs1 + fs2*fs2 + fs3*fs3);
+      fn = xmu * fabs(ccel*r);
+
+      if (fs > fn) {
+        if (shrmag != 0.0) {
+          // same expression as the serial compute, which divides the
+          // damping by 8.84/8*kt here and not by ktfac
+          shear[0] = (fn/fs) * (shear[0] + tdamp*vtr1/8.84*8.0/kt) -
+            tdamp*vtr1/8.84*8.0/kt;
+          shear[1] = (fn/fs) * (shear[1] + tdamp*vtr2/8.84*8.0/kt) -
+            tdamp*vtr2/8.84*8.0/kt;
+          shear[2] = (fn/fs) * (shear[2] + tdamp*vtr3/8.84*8.0/kt) -
+            tdamp*vtr3/8.84*8.0/kt;
+          fs1 *= fn/fs;
+          fs2 *= fn/fs;
+          fs3 *= fn/fs;
+        } else fs1 = fs2 = fs3 = 0.0;
+      }
+
+      // forces & torques
+
+      fx = delx*ccel + fs1;
+      fy = dely*ccel + fs2;
+      fz = delz*ccel + fs3;
+      f[i][0] += fx;
+      f[i][1] += fy;
+      f[i][2] += fz;
+
+      tor1 = rinv * (dely*fs3 - delz*fs2);
+      tor2 = rinv * (delz*fs1 - delx*fs3);
+      tor3 = rinv * (delx*fs2 - dely*fs1);
+      torque[i][0] -= radi*tor1;
+      torque[i][1] -= radi*tor2;
+      torque[i][2] -= radi*tor3;
+
+      if (j < nlocal) {
+        f[j][0] -= fx;
+        f[j][1] -= fy;
+        f[j][2] -= fz;
+        torque[j][0] -= radj*tor1;
+        torque[j][1] -= radj*tor2;
+        torque[j][2] -= radj*tor3;
+      }
+    }
+  }
+
+  return ratiomin;
+}
+
+/* ----------------------------------------------------------------------
+   grow the per-thread arrays for nthr threads, nall atoms and jmax
+   neighbors per atom
+------------------------------------------------------------------------- */
+
+void PairGranHertzFixHistoryOMP::grow_thread_arrays(int nthr, int nall,
+                                                    int jmax)
+{
+  if (nthr != nthreads || nall > maxall || jmax > maxjnum) {
+    destroy_thread_arrays();
+
+    nthreads = nthr;
+    maxall = (nall > maxall) ? nall : maxall;
+    maxjnum = (jmax > maxjnum) ? jmax : maxjnum;
+    if (maxjnum < 1) maxjnum = 1;
+
+    if (nthreads > 1) {
+      memory->create(thr_f,nthreads-1,maxall,3,"pair:thr_f");
+      memory->create(thr_torque,nthreads-1,maxall,3,"pair:thr_torque");
+    }
+    memory->create(thr_contact,nthreads,maxjnum,"pair:thr_contact");
+    memory->create(thr_rsq,nthreads,maxjnum,"pair:thr_rsq");
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+void PairGranHertzFixHistoryOMP::destroy_thread_arrays()
+{
+  memory->destroy(thr_f);
+  memory->destroy(thr_torque);
+  memory->destroy(thr_contact);
+  memory->destroy(thr_rsq);
+  thr_f = NULL;
+  thr_torque = NULL;
+  thr_contact = NULL;
+  thr_rsq = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+double PairGranHertzFixHistoryOMP::memory_usage()
+{
+  double bytes = PairGranHertzFixHistory::memory_usage();
+  if (nthreads > 1) bytes += 2.0 * (nthreads-1) * maxall * 3 * sizeof(double);
+  bytes += (double) nthreads * maxjnum * (sizeof(int) + sizeof(double));
+  return bytes;
+}
@@ -0,0 +1,58 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef PAIR_CLASS
+
+PairStyle(gran/hertzFix/history/omp,PairGranHertzFixHistoryOMP)
+
+#else
+
+#ifndef LMP_PAIR_GRAN_HERTZFIX_HISTORY_OMP_H
+#define LMP_PAIR_GRAN_HERTZFIX_HISTORY_OMP_H
+
+#include "pair_gran_hertzFix_history.h"
+
+namespace LAMMPS_NS {
+
+// gran/hertzFix/history with the atoms I split over OpenMP threads
+// (OMP_NUM_THREADS). Thread 0 accumulates into f and torque, the other
+// threads into private arrays summed at the end. The neighbors of I are
+// first screened for contact in a branch-free loop, the forces are then
+// evaluated for the touching pairs only. Energy/virial tallies use the
+// serial compute.
+
+class PairGranHertzFixHistoryOMP : public PairGranHertzFixHistory {
+ public:
+  PairGranHertzFixHistoryOMP(class LAMMPS *);
+  virtual ~PairGranHertzFixHistoryOMP();
+  virtual void compute(int, int);
+  virtual double memory_usage();
+
+ protected:
+  int nthreads;           // threads of the last compute
+  int maxall;             // atoms (owned + ghost) of the thread arrays
+  double ***thr_f;        // forces of threads 1 to nthreads-1
+  double ***thr_torque;   // torques of threads 1 to nthreads-1
+  int maxjnum;            // length of the contact lists
+  int **thr_contact;      // touching neighbors of I, per thread
+  double **thr_rsq;       // rsq of the neighbors of I, per thread
+
+  void grow_thread_arrays(int, int, int);
+  void destroy_thread_arrays();
+  double eval(int, int, int, int);
+};
+
+}
+
+#endif
+#endif
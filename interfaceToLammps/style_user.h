@@ -100,10 +100,12 @@ FixStyle(wall/granFix,FixWallGranFix)
 
 #ifdef PairInclude
 #include "pair_gran_hertzFix_history.h"
+#include "pair_gran_hertzFix_history_omp.h"
 #endif
 
 #ifdef PairClass
 PairStyle(gran/hertzFix/history,PairGranHertzFixHistory)
+PairStyle(gran/hertzFix/history/omp,PairGranHertzFixHistoryOMP)
 #endif
 
 #ifdef RegionInclude